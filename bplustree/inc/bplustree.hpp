@@ -1,34 +1,317 @@
-#include <stack>
+#include "bplustreetraits.hpp"
+#include "nodearena.hpp"
+#include "valueslot.hpp"
+#include "cursor.hpp"
+#include "treestats.hpp"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
 
+template <typename Traits>
 class Node;
+template <typename Traits>
 class InternalNode;
+template <typename Traits>
 class LeafNode;
+template <typename Traits>
+class FrozenTree;
+
+template <typename Traits>
+class BasicBplustree {
+	typedef ::Node<Traits> Node;
+	typedef ::InternalNode<Traits> InternalNode;
+	typedef ::LeafNode<Traits> LeafNode;
+	friend class BasicCursor<Traits>;
 
-class Bplustree {
 	public:
-		Bplustree(const int order);
-		~Bplustree();
+		// Lookups multiSearch advances in lockstep, by default and at most.
+		static constexpr int defaultGroupSize = 16;
+		static constexpr int maxGroupSize = 64;
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Value Value;
+		typedef typename Traits::Compare Compare;
+		typedef BasicValueSlot<Value> ValueSlot;
+		typedef BasicCursor<Traits> Cursor;
+		typedef std::map<Key, std::vector<Value>, Compare> ScanResult;
+		typedef ValueAggregate<Value> Aggregate;
+
+		// Entries of one scan partition, in key order.
+		struct ScanChunk {
+			std::vector<Key> keys;
+			std::vector<const ValueSlot *> values;
+		};
+
+		// Keys from start up to end, including end only for the last partition of a scan.
+		struct ScanPartition {
+			Key start;
+			Key end;
+			bool endInclusive;
+		};
+
+		/*
+		Finger for lookups with key locality. It remembers the last leaf
+		reached, its parent, the key range of each and the version of the
+		tree structure they were read at. A hint goes stale as soon as
+		nodes of its tree are split, merged or rebuilt, and a stale or
+		foreign hint just falls back to a descent from the root. Hints are
+		not shared between threads.
+		*/
+		class SearchHint {
+			public:
+				SearchHint() : tree(nullptr), version(0), leaf(nullptr), parent(nullptr), childIndex(0), hasLow(false), hasHigh(false), parentHasLow(false), parentHasHigh(false), numHits(0), numWalks(0), numDescents(0) {}
+				// Lookups served by the hinted leaf, by a sibling near it, and by a descent.
+				long long getNumHits() const { return numHits; }
+				long long getNumWalks() const { return numWalks; }
+				long long getNumDescents() const { return numDescents; }
+
+			private:
+				friend class BasicBplustree;
+				const BasicBplustree *tree;
+				unsigned long long version;
+				LeafNode *leaf;
+				InternalNode *parent;
+				int childIndex;
+				Key low;
+				Key high;
+				Key parentLow;
+				Key parentHigh;
+				bool hasLow;
+				bool hasHigh;
+				bool parentHasLow;
+				bool parentHasHigh;
+				long long numHits;
+				long long numWalks;
+				long long numDescents;
+		};
+
+		BasicBplustree(const int order = Traits::leafOrder, const bool useHugePages = false);
+		~BasicBplustree();
 		int getOrder();
-		void insert(const int key, const int value);
-		void insert(const int key, const std::vector<int> &values);
-		bool update(const int key, const std::vector<int> &values, const bool insertIfNotFound = false);
-		const std::vector<int> *search(const int key);
-		std::map<int, std::vector<int>> scan(const int start, const int end);
-		std::map<int, std::vector<int>> scanFull();
-		bool remove(const int key);
+		int getInternalOrder();
+		void insert(const Key &key, const Value value);
+		void insert(const Key &key, const std::vector<Value> &values);
+		void insert(const Key &key, const Value value, SearchHint *hint);
+		void insertBatch(const std::vector<Key> &keys, const std::vector<Value> &values);
+		bool update(const Key &key, const std::vector<Value> &values, const bool insertIfNotFound = false);
+		bool update(const Key &key, const std::vector<Value> &values, SearchHint *hint, const bool insertIfNotFound = false);
+		const ValueSlot *search(const Key &key);
+		const ValueSlot *search(const Key &key, SearchHint *hint) const;
+		void multiSearch(const std::vector<Key> &keys, std::vector<const ValueSlot *> &results, const int groupSize = defaultGroupSize) const;
+		ScanResult scan(const Key &start, const Key &end);
+		ScanResult scanFull();
+		Cursor getCursor() const;
+		std::vector<ScanPartition> getScanPartitions(const Key &start, const Key &end, const int minPartitions) const;
+		template <typename Pool, typename Visitor>
+		void parallelScan(Pool &pool, const Key &start, const Key &end, const Visitor &visitor) const;
+		template <typename Pool>
+		std::vector<ScanChunk> parallelScan(Pool &pool, const Key &start, const Key &end) const;
+		template <typename Pool, typename Visitor>
+		void parallelScanFull(Pool &pool, const Visitor &visitor) const;
+		template <typename Pool>
+		std::vector<ScanChunk> parallelScanFull(Pool &pool) const;
+		bool remove(const Key &key);
+		int removeRange(const Key &start, const Key &end);
+		BasicBplustree *splitAt(const Key &key);
+		void concat(BasicBplustree &other);
 		void show();
-		int getNumKeysStored();
+		int getNumKeysStored() const;
+		TreeStats getStats() const;
+		bool isBalanced() const;
+		std::size_t getNodeBytesReserved() const;
+		std::size_t getNodeBytesInUse() const;
+		std::size_t getValueBytesReserved() const;
+		std::size_t getValueBytesInUse() const;
+		void bulkLoad(const std::vector<Key> &keys, const std::vector<Value> &values, const double fillFactor = 1.0);
+		void setRelaxedRemoves(const bool relaxed);
+		bool needsCompaction(const double threshold) const;
+		void compact(const double fillFactor = 1.0);
+		void freeze();
+		void thaw(const double fillFactor = 1.0);
+		bool isFrozen() const;
+		std::size_t getFrozenBytes() const;
+		void setSubtreeCounts(const bool enabled);
+		int rank(const Key &key) const;
+		const ValueSlot *select(const int rank, Key *key) const;
+		int countRange(const Key &start, const Key &end) const;
+		Aggregate aggregate(const Key &start, const Key &end) const;
+		template <typename Pool>
+		Aggregate parallelAggregate(Pool &pool, const Key &start, const Key &end) const;
 
 	private:
+		// Bounds the height of the tree, every node but the root has at least two children.
+		static const int maxHeight = 64;
+		// Entries handed to a parallel scan visitor at a time.
+		static const int scanBatchSize = 256;
+		// Share of the entries kept by the left node when a run of appends splits the rightmost path.
+		static constexpr double appendSplitFraction = 0.9;
+		// Siblings a hinted lookup steps through before descending from the root.
+		static const int maxHintWalk = 4;
 		int order;
+		int internalOrder;
+		// Removes leave non-empty leaves underfull instead of rebalancing them.
+		bool relaxedRemoves;
+		// Inserts and removes keep the key counts of internal nodes exact, for rank, select and countRange.
+		bool subtreeCounts;
+		bool useHugePages;
+		// Read-only image serving all reads while the tree is frozen, null otherwise.
+		FrozenTree<Traits> *frozen;
 		Node *root;
-		void findSearchPath(const int key, Node* node, std::stack<Node *> *path);
-		bool remove(InternalNode *parent, Node *node, const int key, int *&oldChildEntry);
-		LeafNode *getLeftLeaf();
+		// Rightmost leaf and the separator bounding it from below, rebuilt on demand when null.
+		LeafNode *rightmostLeaf;
+		Key rightmostLow;
+		bool rightmostIsBounded;
+		// Consecutive inserts that appended past the last key of the tree.
+		int appendStreak;
+		// Bumped whenever nodes are split, merged, redistributed or rebuilt, staling search hints.
+		unsigned long long structureVersion;
+		NodeArena leafArena;
+		NodeArena internalArena;
+		ValueArena valueArena;
+		StatCounter numKeys;
+		StatCounter numValues;
+		StatCounter height;
+		StatCounter numLeaves;
+		StatCounter numInternalNodes;
+		StatCounter numSplits;
+		StatCounter numMerges;
+		StatCounter numRedistributions;
+		StatCounter numDeferredRemoves;
+		StatCounter numAppends;
+		int findSearchPath(const Key &key, Node **path) const;
+		LeafNode *findLeaf(const Key &key) const;
+		LeafNode *findInsertLeaf(const Key &key);
+		LeafNode *findHintedLeaf(const Key &key, SearchHint *hint) const;
+		void insertIntoLeaf(LeafNode *leaf, const Key &key, const Value value);
+		bool updateLeaf(LeafNode *leaf, const Key &key, const std::vector<Value> &values, const bool insertIfNotFound);
+		void split(const Key &key, LeafNode *leaf);
+		void insertInParent(const Key &key, Node *left, Key keyToParent, Node *right, const bool append);
+		void insertInPath(Node **path, const int depth, Node *left, Key keyToParent, Node *right, const bool append);
+		LeafNode *findLeaf(const Key &key, Key *upperBound, bool *isBounded) const;
+		void mergeRun(LeafNode *leaf, const std::pair<Key, Value> *first, const std::pair<Key, Value> *last, std::vector<Key> &mergedKeys, std::vector<ValueSlot> &mergedValues);
+		LeafNode *getLeftLeaf() const;
+		bool getKeyBounds(Key *first, Key *last) const;
+		void bulkLoad(const std::vector<std::pair<Key, Value>> &pairs, const int numUniqueKeys, const double fillFactor);
+		void buildLevels(std::vector<Node *> &level, std::vector<Key> &levelLowKeys, const double fillFactor);
+		void collectEntries(std::vector<Key> *keys, std::vector<ValueSlot> *slots) const;
+		void loadEntries(const std::vector<Key> &keys, const std::vector<ValueSlot> &slots, const double fillFactor);
+		void throwIfFrozen() const;
+		void addToSubtreeCounts(const Key &key, const int delta);
+		int recountSubtree(Node *node);
+		int countKeysBelow(const Key &key, const bool inclusive) const;
+		void aggregateRange(const Key &start, const Key &end, const bool endInclusive, Aggregate *result) const;
 		void printTree(Node *node, const int level, std::string prevString, const std::vector<int> *parentKeyLengths);
 		std::string printNode(Node *node, const int level, std::string prevString, const std::vector<int> *parentKeyLengths);
+		void trimRange(Node *node, const Key &start, const Key &end, const bool startInside, const bool endInside);
+		void repairPath(const Key &key);
+		void dropSubtree(Node *node);
+		bool isEmptySubtree(Node *node) const;
+		void dropEmptyChild(InternalNode *parent, const int index);
+		void repairChild(InternalNode *parent, const int index);
+		Node *cutRight(Node *node, const Key &key, BasicBplustree *right);
+		void countSubtree(Node *node, TreeStats *stats, std::size_t *valueBytes) const;
+		bool isBalancedBelow(Node *node, const int depth, int *leafDepth) const;
 		void destroy(Node *node);
+		void releaseNodes();
+		template <typename Pool, typename Visitor>
+		void scanPartitions(Pool &pool, const std::vector<ScanPartition> &partitions, const Visitor &visitor) const;
 };
+
+template <typename Traits>
+template <typename Pool, typename Visitor>
+void BasicBplustree<Traits>::scanPartitions(Pool &pool, const std::vector<ScanPartition> &partitions, const Visitor &visitor) const {
+	/*
+	Each block of the loop walks its partitions with a cursor of its own.
+	visitor(partition, keys, values, count) is called with batches in key
+	order within a partition, but from several threads at once. The tree
+	must not be modified until the scan returns.
+	*/
+	const int numBlocks = std::min<std::size_t>(partitions.size(), 4 * pool.get_thread_count());
+	pool.parallelize_loop(0, partitions.size(), [&](const std::size_t first, const std::size_t last) {
+		Key keys[scanBatchSize];
+		const ValueSlot *values[scanBatchSize];
+		Cursor cursor(this);
+		for (std::size_t partition = first; partition < last; partition++) {
+			const ScanPartition &range = partitions[partition];
+			cursor.seek(range.start);
+			int numFetched;
+			while ((numFetched = cursor.fetch(keys, values, scanBatchSize, range.end, range.endInclusive)) > 0) {
+				visitor(partition, keys, values, numFetched);
+			}
+		}
+	}, numBlocks);
+}
+
+template <typename Traits>
+template <typename Pool, typename Visitor>
+void BasicBplustree<Traits>::parallelScan(Pool &pool, const Key &start, const Key &end, const Visitor &visitor) const {
+	scanPartitions(pool, getScanPartitions(start, end, pool.get_thread_count()), visitor);
+}
+
+template <typename Traits>
+template <typename Pool>
+std::vector<typename BasicBplustree<Traits>::ScanChunk> BasicBplustree<Traits>::parallelScan(Pool &pool, const Key &start, const Key &end) const {
+	/*
+	Collects the scan into one chunk per partition. Concatenating the
+	chunks in order gives the entries of [start, end] in key order.
+	*/
+	const std::vector<ScanPartition> partitions = getScanPartitions(start, end, pool.get_thread_count());
+	std::vector<ScanChunk> chunks(partitions.size());
+	scanPartitions(pool, partitions, [&chunks](const std::size_t partition, const Key *keys, const ValueSlot *const *values, const int count) {
+		ScanChunk &chunk = chunks[partition];
+		chunk.keys.insert(chunk.keys.end(), keys, keys + count);
+		chunk.values.insert(chunk.values.end(), values, values + count);
+	});
+	return chunks;
+}
+
+template <typename Traits>
+template <typename Pool, typename Visitor>
+void BasicBplustree<Traits>::parallelScanFull(Pool &pool, const Visitor &visitor) const {
+	Key first, last;
+	if (getKeyBounds(&first, &last)) {
+		parallelScan(pool, first, last, visitor);
+	}
+}
+
+template <typename Traits>
+template <typename Pool>
+std::vector<typename BasicBplustree<Traits>::ScanChunk> BasicBplustree<Traits>::parallelScanFull(Pool &pool) const {
+	Key first, last;
+	if (!getKeyBounds(&first, &last)) {
+		return std::vector<ScanChunk>();
+	}
+	return parallelScan(pool, first, last);
+}
+
+template <typename Traits>
+template <typename Pool>
+typename BasicBplustree<Traits>::Aggregate BasicBplustree<Traits>::parallelAggregate(Pool &pool, const Key &start, const Key &end) const {
+	/*
+	Aggregates the scan partitions of [start, end] in parallel, one
+	partial result each, and combines the partials. The tree must not be
+	modified until it returns.
+	*/
+	const std::vector<ScanPartition> partitions = getScanPartitions(start, end, pool.get_thread_count());
+	std::vector<Aggregate> partials(partitions.size());
+	const int numBlocks = std::min<std::size_t>(partitions.size(), 4 * pool.get_thread_count());
+	pool.parallelize_loop(0, partitions.size(), [&](const std::size_t first, const std::size_t last) {
+		for (std::size_t partition = first; partition < last; partition++) {
+			const ScanPartition &range = partitions[partition];
+			aggregateRange(range.start, range.end, range.endInclusive, &partials[partition]);
+		}
+	}, numBlocks);
+	Aggregate result;
+	for (const Aggregate &partial : partials) {
+		result.add(partial);
+	}
+	return result;
+}
+
+typedef BasicBplustree<BplustreeTraits<>> Bplustree;
+
+template <int LeafOrder, int InternalOrder = LeafOrder>
+using FixedBplustree = BasicBplustree<BplustreeTraits<LeafOrder, InternalOrder>>;
+
+template <typename Key>
+using KeyBplustree = BasicBplustree<KeyTraits<Key>>;
@@ -0,0 +1,55 @@
+#ifndef BPLUSTREETRAITS_HPP
+#define BPLUSTREETRAITS_HPP
+
+#include "fixedarray.hpp"
+#include "keytypes.hpp"
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+/*
+Compile-time node layout and entry types of a Bplustree. With the
+default orders of 0 the order is given at runtime and nodes keep their
+entries in std::vectors. With positive orders keys, children and values
+live inline in cache line aligned nodes, and the leaf and internal
+fanout can be tuned separately. Keys are ordered by KeyCompare.
+*/
+template <int LeafOrder = 0, int InternalOrder = LeafOrder, typename KeyType = int, typename ValueType = int, typename KeyCompare = std::less<KeyType>>
+struct BplustreeTraits {
+	typedef KeyType Key;
+	typedef ValueType Value;
+	typedef KeyCompare Compare;
+	static_assert((LeafOrder == 0) == (InternalOrder == 0), "either both or none of the orders must be fixed");
+	static_assert(LeafOrder == 0 || (LeafOrder >= 3 && InternalOrder >= 3), "fixed orders must be at least 3");
+	static constexpr int leafOrder = LeafOrder;
+	static constexpr int internalOrder = InternalOrder;
+	static constexpr bool fixedLayout = LeafOrder > 0;
+	static constexpr std::size_t nodeAlignment = fixedLayout ? 64 : alignof(void *);
+};
+
+/*
+Node storage holding up to N entries, N being 0 for runtime sized storage.
+*/
+template <typename T, int N>
+using NodeArray = std::conditional_t<N == 0, std::vector<T>, FixedArray<T, N>>;
+
+/*
+Runtime order layout with keys of type Key.
+*/
+template <typename Key>
+using KeyTraits = BplustreeTraits<0, 0, Key>;
+
+/*
+Layouts the library is explicitly instantiated for: runtime order, nodes
+of four cache lines (256 bytes) and nodes of one 4KB page with int keys,
+and runtime order with 64-bit and 16 byte keys.
+*/
+#define BPLUSTREE_INSTANTIATE(Class) \
+	template class Class<BplustreeTraits<>>; \
+	template class Class<BplustreeTraits<16, 16>>; \
+	template class Class<BplustreeTraits<333, 333>>; \
+	template class Class<KeyTraits<std::int64_t>>; \
+	template class Class<KeyTraits<FixedKey<16>>>;
+
+#endif
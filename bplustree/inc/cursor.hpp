@@ -0,0 +1,64 @@
+#ifndef CURSOR_HPP
+#define CURSOR_HPP
+
+#include "valueslot.hpp"
+
+template <typename Traits>
+class BasicBplustree;
+template <typename Traits>
+class LeafNode;
+
+/*
+Streams the entries of a tree in key order, in either direction, by
+following the leaf links. Keys and values are exposed in place, so a
+cursor is invalidated by any modification of its tree. On a frozen tree
+the cursor walks the entry arrays of the image as one run, with no leaf.
+*/
+template <typename Traits>
+class BasicCursor {
+	typedef ::LeafNode<Traits> LeafNode;
+
+	public:
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Compare Compare;
+		typedef BasicValueSlot<typename Traits::Value> ValueSlot;
+		BasicCursor(const BasicBplustree<Traits> *tree);
+		bool isValid() const { return keys != nullptr; }
+		const Key &getKey() const { return keys[index]; }
+		const ValueSlot &getValues() const { return values[index]; }
+		void seek(const Key &key);
+		void seekToFirst();
+		void seekToLast();
+		int fetch(Key *keys, const ValueSlot **values, const int maxEntries) { return fetchUntil(keys, values, maxEntries, nullptr, true); }
+		int fetch(Key *keys, const ValueSlot **values, const int maxEntries, const Key &end, const bool inclusive = true) { return fetchUntil(keys, values, maxEntries, &end, inclusive); }
+
+		bool next() {
+			if (++index < numKeys) {
+				return true;
+			}
+			return nextLeaf();
+		}
+
+		bool prev() {
+			if (--index >= 0) {
+				return true;
+			}
+			return prevLeaf();
+		}
+
+	private:
+		const BasicBplustree<Traits> *tree;
+		LeafNode *leaf;
+		const Key *keys;
+		const ValueSlot *values;
+		int numKeys;
+		int index;
+		void enterLeaf(LeafNode *leaf, const int index);
+		void enterImage(const int index);
+		void invalidate();
+		bool nextLeaf();
+		bool prevLeaf();
+		int fetchUntil(Key *keys, const ValueSlot **values, const int maxEntries, const Key *end, const bool inclusive);
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef FIXEDARRAY_HPP
+#define FIXEDARRAY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/*
+Vector-like array of at most N elements stored inline in its owner.
+Only the subset of the std::vector interface used by the nodes is
+provided. Elements are assumed trivially copyable.
+*/
+template <typename T, int N>
+class FixedArray {
+	public:
+		typedef T *iterator;
+		typedef const T *const_iterator;
+
+		std::size_t size() const { return length; }
+		bool empty() const { return length == 0; }
+		void reserve(const std::size_t) const {}
+		void clear() { length = 0; }
+		T *data() { return elements; }
+		const T *data() const { return elements; }
+		iterator begin() { return elements; }
+		iterator end() { return elements + length; }
+		const_iterator begin() const { return elements; }
+		const_iterator end() const { return elements + length; }
+		T &operator[](const std::size_t index) { return elements[index]; }
+		const T &operator[](const std::size_t index) const { return elements[index]; }
+		T &front() { return elements[0]; }
+		T &back() { return elements[length - 1]; }
+
+		void push_back(const T &value) {
+			elements[length++] = value;
+		}
+
+		iterator insert(const_iterator pos, const T &value) {
+			T *at = const_cast<T *>(pos);
+			std::copy_backward(at, end(), end() + 1);
+			*at = value;
+			length++;
+			return at;
+		}
+
+		template <typename InputIt>
+		iterator insert(const_iterator pos, InputIt first, InputIt last) {
+			T *at = const_cast<T *>(pos);
+			const std::size_t count = last - first;
+			std::copy_backward(at, end(), end() + count);
+			std::copy(first, last, at);
+			length += count;
+			return at;
+		}
+
+		iterator erase(const_iterator pos) {
+			T *at = const_cast<T *>(pos);
+			std::copy(at + 1, end(), at);
+			length--;
+			return at;
+		}
+
+		iterator erase(const_iterator first, const_iterator last) {
+			T *at = const_cast<T *>(first);
+			std::copy(const_cast<T *>(last), end(), at);
+			length -= last - first;
+			return at;
+		}
+
+		template <typename InputIt>
+		void assign(InputIt first, InputIt last) {
+			std::copy(first, last, elements);
+			length = last - first;
+		}
+
+	private:
+		std::uint32_t length = 0;
+		T elements[N];
+};
+
+#endif
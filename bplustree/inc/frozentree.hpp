@@ -0,0 +1,56 @@
+#ifndef FROZENTREE_HPP
+#define FROZENTREE_HPP
+
+#include "valueslot.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/*
+Immutable, read-optimized image of the entries of a tree. Keys and value
+slots are packed in key order into blocks of keysPerNode entries, with a
+static search tree on top of the blocks. Each internal level is an array
+of nodes of keysPerNode separator keys, the largest key below each of
+the first keysPerNode children. The children of node j are nodes
+j * fanout to j * fanout + keysPerNode of the level below, so no child
+pointers are stored. All levels live root first in one mapping, every
+level starting on a cache line.
+*/
+template <typename Traits>
+class FrozenTree {
+	public:
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Compare Compare;
+		typedef BasicValueSlot<typename Traits::Value> ValueSlot;
+		static_assert(std::is_trivially_copyable_v<Key>, "keys must be trivially copyable");
+		// Keys per node and per block, filling two cache lines.
+		static constexpr int keysPerNode = std::max<int>(2, 128 / sizeof(Key));
+		static constexpr int fanout = keysPerNode + 1;
+
+		FrozenTree(const std::vector<Key> &keys, const std::vector<ValueSlot> &values, const bool useHugePages = false);
+		~FrozenTree();
+		FrozenTree(const FrozenTree &) = delete;
+		FrozenTree &operator=(const FrozenTree &) = delete;
+		int size() const { return numEntries; }
+		const Key *getKeys() const { return keys; }
+		const ValueSlot *getValues() const { return values; }
+		int lowerBound(const Key &key) const;
+		const ValueSlot *search(const Key &key) const;
+		int getNumLevels() const { return levels.size() + 1; }
+		int getNumBlocks() const { return (numEntries + keysPerNode - 1) / keysPerNode; }
+		long long getNumInternalNodes() const;
+		std::size_t getBytes() const { return bytes; }
+
+	private:
+		const int numEntries;
+		void *image;
+		std::size_t bytes;
+		const Key *keys;
+		const ValueSlot *values;
+		// Separator keys of each internal level, root first, and the number of nodes below each.
+		std::vector<const Key *> levels;
+		std::vector<int> levelChildren;
+};
+
+#endif
@@ -1,22 +1,40 @@
 #include "node.hpp"
 #include <tuple>
 
+template <typename Traits>
 class LeafNode;
 
-class InternalNode : public Node {
+template <typename Traits>
+class alignas(Traits::nodeAlignment) InternalNode : public Node<Traits> {
+	typedef ::Node<Traits> Node;
+	typedef ::LeafNode<Traits> LeafNode;
+
 	public:
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Compare Compare;
+		typedef NodeArray<Key, Traits::internalOrder> Keys;
+		typedef NodeArray<Node *, Traits::fixedLayout ? Traits::internalOrder + 1 : 0> Children;
+		// Number of keys below each child, kept in step with the children.
+		typedef NodeArray<int, Traits::fixedLayout ? Traits::internalOrder + 1 : 0> Counts;
 		InternalNode();
-		std::vector<Node *> *getChildren();
-		void insert(const int key, Node* right);
-		void insert(const int key, Node* left, Node* right);
-		bool remove(const int key);
+		Keys *getKeys();
+		int getNumKeys() const;
+		Children *getChildren();
+		Counts *getCounts();
+		int getNumSubtreeKeys() const;
+		int findChildIndex(const Key &key) const;
+		void insert(const Key &key, Node* right);
+		void insert(const Key &key, Node* left, Node* right);
+		bool remove(const Key &key);
 		void removeByKeyIndex(const int keyIndex);
-		InternalNode *split(int *keyToParent);
-		std::tuple<Node *, bool, int, int> getSibling(const Node *node, const int order, const Node *root) const;
-		void redistribute(InternalNode *node, InternalNode *sibling, const bool siblingIsOnRHS, const int splittingKey, const int splittingKeyIndex);
-		void redistribute(LeafNode *node, LeafNode *sibling, const bool siblingIsOnRHS, const int splittingKey, const int splittingKeyIndex);
-		void merge(InternalNode *sibling, const int splittingKey);
+		InternalNode *split(Key *keyToParent, NodeArena &arena, const int splitIndex);
+		std::tuple<Node *, bool, Key, int> getSibling(const int index, const int order, const Node *root) const;
+		void redistribute(InternalNode *node, InternalNode *sibling, const bool siblingIsOnRHS, const Key &splittingKey, const int splittingKeyIndex);
+		void redistribute(LeafNode *node, LeafNode *sibling, const bool siblingIsOnRHS, const Key &splittingKey, const int splittingKeyIndex);
+		void merge(InternalNode *sibling, const Key &splittingKey, NodeArena &arena);
 
 	private:
-		std::vector<Node *> children;
+		Keys keys;
+		Children children;
+		Counts counts;
 };
@@ -0,0 +1,74 @@
+#ifndef KEYTYPES_HPP
+#define KEYTYPES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+/*
+Fixed-width binary key, e.g. a 16 byte UUID. Keys are kept in
+normalized form, so that byte-wise memcmp order is the key order.
+*/
+template <std::size_t N>
+struct FixedKey {
+	unsigned char bytes[N];
+
+	static FixedKey fromInteger(const long long value) {
+		/*
+		Stores value big-endian in the trailing bytes with the sign bit
+		flipped, which makes memcmp order agree with integer order.
+		*/
+		static_assert(N >= sizeof(std::uint64_t), "FixedKey must hold at least 8 bytes");
+		FixedKey key = {};
+		std::uint64_t normalized = static_cast<std::uint64_t>(value) ^ (std::uint64_t(1) << 63);
+		for (std::size_t i = 0; i < sizeof(normalized); i++) {
+			key.bytes[N - 1 - i] = normalized >> (8 * i);
+		}
+		return key;
+	}
+
+	bool operator<(const FixedKey &other) const { return std::memcmp(bytes, other.bytes, N) < 0; }
+	bool operator<=(const FixedKey &other) const { return std::memcmp(bytes, other.bytes, N) <= 0; }
+	bool operator==(const FixedKey &other) const { return std::memcmp(bytes, other.bytes, N) == 0; }
+	bool operator!=(const FixedKey &other) const { return std::memcmp(bytes, other.bytes, N) != 0; }
+};
+
+template <std::size_t N>
+std::ostream &operator<<(std::ostream &stream, const FixedKey<N> &key) {
+	std::ios_base::fmtflags flags = stream.flags();
+	stream << std::hex << std::setfill('0');
+	for (std::size_t i = 0; i < N; i++) {
+		stream << std::setw(2) << static_cast<int>(key.bytes[i]);
+	}
+	stream.flags(flags);
+	return stream;
+}
+
+/*
+Builds a key of type Key from an integer, preserving order. Used to
+drive benchmarks and tests with the same integer streams for every key
+type.
+*/
+template <typename Key>
+Key makeKey(const long long value) {
+	if constexpr (std::is_integral_v<Key>) {
+		return static_cast<Key>(value);
+	}
+	else {
+		return Key::fromInteger(value);
+	}
+}
+
+template <typename Key>
+std::string keyToString(const Key &key) {
+	std::ostringstream stream;
+	stream << key;
+	return stream.str();
+}
+
+#endif
@@ -1,25 +1,39 @@
 #include "node.hpp"
+#include "valueslot.hpp"
 #include <map>
 
-class LeafNode : public Node {
+template <typename Traits>
+class alignas(Traits::nodeAlignment) LeafNode : public Node<Traits> {
 	public:
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Value Value;
+		typedef typename Traits::Compare Compare;
+		typedef BasicValueSlot<Value> ValueSlot;
+		typedef NodeArray<Key, Traits::leafOrder> Keys;
+		typedef NodeArray<ValueSlot, Traits::leafOrder> Values;
 		LeafNode();
-		~LeafNode();
 		LeafNode *getNext() const;
 		LeafNode *getPrev() const;
-		std::vector<int> *getValues(const int key); 
-		std::vector<std::vector<int> *> *getValues();
-		LeafNode *scan(const int start, const int end, const LeafNode *startLeaf, std::map<int, std::vector<int>> &result) const;
-		LeafNode *scanFull(std::map<int, std::vector<int>> &result) const;
-		void insert(const int key, const int value);
-		void insert(const int key, const std::vector<int> &values);
-		LeafNode *split(int *keyToParent);
-		bool update(const int key, const std::vector<int> &values);
-		bool remove(const int key);
-		void merge(LeafNode *sibling);
+		void setNext(LeafNode *next);
+		void setPrev(LeafNode *prev);
+		Keys *getKeys();
+		int getNumKeys() const;
+		int getNumSubtreeKeys() const;
+		const ValueSlot *getValues(const Key &key) const;
+		Values *getValues();
+		LeafNode *scan(const Key &start, const Key &end, const LeafNode *startLeaf, std::map<Key, std::vector<Value>, Compare> &result) const;
+		LeafNode *scanFull(std::map<Key, std::vector<Value>, Compare> &result) const;
+		void insert(const Key &key, const Value value, ValueArena &arena);
+		void insert(const Key &key, const std::vector<Value> &values, ValueArena &arena);
+		LeafNode *split(Key *keyToParent, NodeArena &arena, const int splitIndex);
+		bool update(const Key &key, const std::vector<Value> &values, ValueArena &arena, int *numOldValues);
+		bool remove(const Key &key, ValueArena &arena, int *numOldValues);
+		int removeRange(const Key &start, const Key &end, ValueArena &arena, int *numOldValues);
+		void merge(LeafNode *sibling, NodeArena &arena);
 
 	private:
+		Keys keys;
 		LeafNode *next;
 		LeafNode *prev;
-		std::vector<std::vector<int> *> values;
+		Values values;
 };
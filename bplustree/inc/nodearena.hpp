@@ -0,0 +1,67 @@
+#ifndef NODEARENA_HPP
+#define NODEARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/*
+Hands out fixed-size, cache line aligned slots for nodes of one type
+from large slabs. Freed slots are recycled through a free list and all
+slabs are released at once when the arena is destroyed. Slabs can be
+backed by huge pages to cut TLB misses.
+
+Nodes may move to the arena of another tree without being copied, when
+trees are split or concatenated. The receiving arena then shares the
+slabs of the giving one, which are released once neither uses them.
+*/
+class NodeArena {
+	public:
+		NodeArena(const std::size_t objectSize, const bool useHugePages = false);
+		~NodeArena();
+		NodeArena(const NodeArena &) = delete;
+		NodeArena &operator=(const NodeArena &) = delete;
+		void *allocate();
+		void deallocate(void *slot);
+		void clear();
+		void moveSlots(NodeArena &other, const std::size_t numSlots);
+		std::size_t getBytesReserved() const;
+		std::size_t getBytesInUse() const;
+
+		template <typename T>
+		T *newNode() {
+			return new (allocate()) T();
+		}
+
+		template <typename T>
+		void deleteNode(T *node) {
+			node->~T();
+			deallocate(node);
+		}
+
+	private:
+		struct FreeSlot {
+			FreeSlot *next;
+		};
+		// Slabs allocated by one arena, unmapped when the last arena sharing them lets go.
+		struct Slabs {
+			const std::size_t slabSize;
+			std::vector<void *> slabs;
+			Slabs(const std::size_t slabSize) : slabSize(slabSize) {}
+			~Slabs();
+		};
+		const std::size_t slotSize;
+		const std::size_t slabSize;
+		const bool useHugePages;
+		std::shared_ptr<Slabs> slabs;
+		// Slabs of other arenas holding slots moved into this one.
+		std::vector<std::shared_ptr<Slabs>> sharedSlabs;
+		char *bump;
+		char *bumpEnd;
+		FreeSlot *freeList;
+		std::size_t slotsInUse;
+		void addSlab();
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef NODESEARCH_HPP
+#define NODESEARCH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+/*
+Rank search within a node: returns the number of keys smaller than key,
+i.e. the index std::lower_bound would return. The kernel is selected
+once at startup through CPUID; AVX2 and SSE4.2 kernels compare a
+broadcast key against 16 keys at a time and popcount the mask, with
+std::lower_bound as the scalar fallback.
+*/
+extern int (*const rankSearch)(const int *keys, const int numKeys, const int key);
+extern int (*const rankSearch64)(const std::int64_t *keys, const int numKeys, const std::int64_t key);
+
+std::string getRankSearchKernelName();
+
+/*
+Rank search over keys of any type. Signed 32 and 64-bit keys in their
+natural order take the SIMD kernels, other keys std::lower_bound with
+Compare.
+*/
+template <typename Key, typename Compare>
+inline int keyRankSearch(const Key *keys, const int numKeys, const Key &key) {
+	if constexpr (std::is_same_v<Compare, std::less<Key>> && std::is_same_v<Key, std::int32_t>) {
+		return rankSearch(keys, numKeys, key);
+	}
+	else if constexpr (std::is_same_v<Compare, std::less<Key>> && std::is_same_v<Key, std::int64_t>) {
+		return rankSearch64(keys, numKeys, key);
+	}
+	else {
+		return std::lower_bound(keys, keys + numKeys, key, Compare()) - keys;
+	}
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TREESTATS_HPP
+#define TREESTATS_HPP
+
+#include <atomic>
+
+/*
+Counter of a tree statistic. Only the thread modifying the tree writes
+it, so relaxed loads and stores suffice and the write path needs no
+locked instructions, while any thread may read it at any time.
+*/
+class StatCounter {
+	public:
+		StatCounter() : value(0) {}
+		long long get() const { return value.load(std::memory_order_relaxed); }
+		void set(const long long value) { this->value.store(value, std::memory_order_relaxed); }
+		void add(const long long delta) { set(get() + delta); }
+
+	private:
+		std::atomic<long long> value;
+};
+
+/*
+Snapshot of the statistics of a tree. Fields are read one at a time, so
+a snapshot taken during a write may mix values from before and after it.
+*/
+struct TreeStats {
+	long long numKeys;
+	long long numValues;
+	long long height;
+	long long numLeaves;
+	long long numInternalNodes;
+	long long numSplits;
+	long long numMerges;
+	long long numRedistributions;
+	long long numDeferredRemoves;
+	long long numAppends;
+};
+
+#endif
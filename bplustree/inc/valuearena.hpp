@@ -0,0 +1,51 @@
+#ifndef VALUEARENA_HPP
+#define VALUEARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+Allocates blocks of values whose size in bytes is a power of two. Small
+blocks are carved from large chunks, and freed blocks are kept on a
+free list per size class so that updates and removes reuse storage.
+As with NodeArena, blocks may move to another arena, which then shares
+the chunks of this one.
+*/
+class ValueArena {
+	public:
+		ValueArena();
+		~ValueArena();
+		ValueArena(const ValueArena &) = delete;
+		ValueArena &operator=(const ValueArena &) = delete;
+		void *allocate(const std::size_t bytes);
+		void deallocate(void *block, const std::size_t bytes);
+		void clear();
+		void moveBytes(ValueArena &other, const std::size_t bytes);
+		std::size_t getBytesReserved() const;
+		std::size_t getBytesInUse() const;
+		static std::size_t roundSize(const std::size_t bytes);
+
+	private:
+		struct FreeBlock {
+			FreeBlock *next;
+		};
+		// Chunks allocated by one arena, freed when the last arena sharing them lets go.
+		struct Chunks {
+			std::vector<void *> chunks;
+			~Chunks();
+		};
+		static const int numSizeClasses = 32;
+		FreeBlock *freeLists[numSizeClasses];
+		std::shared_ptr<Chunks> chunks;
+		// Chunks of other arenas holding blocks moved into this one.
+		std::vector<std::shared_ptr<Chunks>> sharedChunks;
+		std::size_t bytesReserved;
+		std::size_t bytesInUse;
+		char *bump;
+		char *bumpEnd;
+		static int getSizeClass(const std::size_t bytes);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef VALUESLOT_HPP
+#define VALUESLOT_HPP
+
+#include "valuearena.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+/*
+Count, sum, min and max over values of type T, summed in the widest
+type of the kind of T. min and max are meaningful only if count > 0.
+*/
+template <typename T>
+struct ValueAggregate {
+	typedef std::conditional_t<std::is_floating_point_v<T>, double, long long> Sum;
+	long long count = 0;
+	Sum sum = 0;
+	T min = std::numeric_limits<T>::max();
+	T max = std::numeric_limits<T>::lowest();
+
+	void add(const ValueAggregate &other) {
+		count += other.count;
+		sum += other.sum;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+	}
+};
+
+/*
+The values of one key as stored in a leaf. Up to inlineCapacity values
+are kept in the slot itself. Longer lists spill into a block from the
+tree's ValueArena, in which case the slot holds the block pointer
+instead; the block size follows from the count. Slots are trivially
+copyable and are moved between leaves by copying; the owning leaf
+releases a slot before dropping it.
+*/
+template <typename T>
+class alignas(8) BasicValueSlot {
+	static_assert(std::is_trivially_copyable_v<T>, "values must be trivially copyable");
+	static_assert(sizeof(T) <= sizeof(void *), "values must not be wider than a pointer");
+
+	public:
+		typedef T value_type;
+		typedef const T *const_iterator;
+		static const std::uint32_t inlineCapacity = (16 - std::max(sizeof(std::uint32_t), alignof(T))) / sizeof(T);
+
+		BasicValueSlot() : count(0) {}
+		std::size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		bool isInline() const { return count <= inlineCapacity; }
+		const T *data() const { return isInline() ? inlineValues : getBlock(); }
+		const_iterator begin() const { return data(); }
+		const_iterator end() const { return data() + count; }
+		const T &operator[](const std::size_t index) const { return data()[index]; }
+		const T &front() const { return data()[0]; }
+		const T &back() const { return data()[count - 1]; }
+		// Bytes of the arena block holding the values, none if they are inline.
+		std::size_t getBlockBytes() const { return isInline() ? 0 : getBlockSize(count); }
+		void push_back(const T value, ValueArena &arena);
+		void append(const T *first, const T *last, ValueArena &arena);
+		void assign(const T *first, const T *last, ValueArena &arena);
+		void release(ValueArena &arena);
+		static void aggregate(const BasicValueSlot *slots, const std::size_t numSlots, ValueAggregate<T> *result);
+
+	private:
+		std::uint32_t count;
+		// When spilled, the bytes of inlineValues hold the block pointer
+		T inlineValues[inlineCapacity];
+		T *getBlock() const {
+			T *block;
+			std::memcpy(&block, inlineValues, sizeof(block));
+			return block;
+		}
+		void setBlock(T *block) { std::memcpy(inlineValues, &block, sizeof(block)); }
+		static std::size_t getBlockSize(const std::uint32_t count) { return ValueArena::roundSize(count * sizeof(T)); }
+		void grow(const std::uint32_t newCount, ValueArena &arena);
+};
+
+typedef BasicValueSlot<int> ValueSlot;
+
+static_assert(sizeof(ValueSlot) == 16, "ValueSlot must fit four slots to a cache line");
+static_assert(sizeof(BasicValueSlot<std::int64_t>) == 16, "ValueSlot must fit four slots to a cache line");
+
+#endif
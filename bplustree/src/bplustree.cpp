@@ -1,186 +1,542 @@
 #include "bplustree.hpp"
+#include "frozentree.hpp"
 #include "internalnode.hpp"
 #include "leafnode.hpp"
+#include "nodesearch.hpp"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <thread>
 
-Bplustree::Bplustree(const int order) : order(order) {
-	root = new LeafNode();
+template <typename Traits>
+BasicBplustree<Traits>::BasicBplustree(const int order, const bool useHugePages) :
+	order(order),
+	internalOrder(order),
+	relaxedRemoves(false),
+	subtreeCounts(false),
+	useHugePages(useHugePages),
+	frozen(nullptr),
+	rightmostLeaf(nullptr),
+	rightmostIsBounded(false),
+	appendStreak(0),
+	structureVersion(0),
+	leafArena(sizeof(LeafNode), useHugePages),
+	internalArena(sizeof(InternalNode), useHugePages) {
+	if (Traits::fixedLayout) {
+		if (order != Traits::leafOrder) {
+			throw std::string("order must equal the leaf order of a fixed layout\n");
+		}
+		internalOrder = Traits::internalOrder;
+	}
+	root = leafArena.newNode<LeafNode>();
+	height.set(1);
+	numLeaves.set(1);
 }
 
-int Bplustree::getOrder() {
+template <typename Traits>
+int BasicBplustree<Traits>::getOrder() {
 	return order;
 }
 
-void Bplustree::insert(const int key, const int value) {
-	std::stack<Node *> path;
-	findSearchPath(key, root, &path);
-	LeafNode *leaf = static_cast<LeafNode *>(path.top());
-	path.pop();
-	leaf->insert(key, value);
+template <typename Traits>
+int BasicBplustree<Traits>::getInternalOrder() {
+	return internalOrder;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insert(const Key &key, const Value value) {
+	throwIfFrozen();
+	insertIntoLeaf(findInsertLeaf(key), key, value);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insert(const Key &key, const Value value, SearchHint *hint) {
+	throwIfFrozen();
+	appendStreak = 0;
+	insertIntoLeaf(findHintedLeaf(key, hint), key, value);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insertIntoLeaf(LeafNode *leaf, const Key &key, const Value value) {
+	const int numLeafKeys = leaf->getKeys()->size();
+	leaf->insert(key, value, valueArena);
+	numKeys.add(leaf->getKeys()->size() - numLeafKeys);
+	numValues.add(1);
+	addToSubtreeCounts(key, leaf->getKeys()->size() - numLeafKeys);
 	if (leaf->getKeys()->size() == order) {
-		int *keyToParent = new int;
-		Node *right = leaf->split(keyToParent);
-		if (path.empty()) {
-			InternalNode *newRoot = new InternalNode();
-			newRoot->insert(*keyToParent, leaf, right);
-			root = newRoot;
-			return;
-		}
-		InternalNode *internal = static_cast<InternalNode *>(path.top());
-		path.pop();
-		internal->insert(*keyToParent, right);
-		while (internal->getKeys()->size() == order) {
-			right = internal->split(keyToParent);
-			if (!path.empty()) {
-				internal = static_cast<InternalNode *>(path.top());
-				path.pop();
-				internal->insert(*keyToParent, right);
-			}
-			else {
-				InternalNode *newRoot = new InternalNode();
-				newRoot->insert(*keyToParent, internal, right);
-				root = newRoot;
-				return;
-			}
+		split(key, leaf);
+	}
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insert(const Key &key, const std::vector<Value> &values) {
+	throwIfFrozen();
+	LeafNode *leaf = findInsertLeaf(key);
+	const int numLeafKeys = leaf->getKeys()->size();
+	leaf->insert(key, values, valueArena);
+	numKeys.add(leaf->getKeys()->size() - numLeafKeys);
+	numValues.add(values.size());
+	addToSubtreeCounts(key, leaf->getKeys()->size() - numLeafKeys);
+	if (leaf->getKeys()->size() == order) {
+		split(key, leaf);
+	}
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::update(const Key &key, const std::vector<Value> &values, const bool insertIfNotFound) {
+	throwIfFrozen();
+	return updateLeaf(findLeaf(key), key, values, insertIfNotFound);
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::update(const Key &key, const std::vector<Value> &values, SearchHint *hint, const bool insertIfNotFound) {
+	throwIfFrozen();
+	return updateLeaf(findHintedLeaf(key, hint), key, values, insertIfNotFound);
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::updateLeaf(LeafNode *leaf, const Key &key, const std::vector<Value> &values, const bool insertIfNotFound) {
+	int numOldValues;
+	if (leaf->update(key, values, valueArena, &numOldValues)) {
+		numValues.add(static_cast<long long>(values.size()) - numOldValues);
+		return true;
+	}
+	if (insertIfNotFound) {
+		leaf->insert(key, values, valueArena);
+		numKeys.add(1);
+		numValues.add(values.size());
+		addToSubtreeCounts(key, 1);
+		if (leaf->getKeys()->size() == order) {
+			split(key, leaf);
 		}
-		delete keyToParent;
+		return true;
 	}
-	else {
-		return;
+	return false;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::split(const Key &key, LeafNode *leaf) {
+	/*
+	Splits the overfull leaf that key was just inserted into, and any
+	ancestors that overflow as a result. The path is only recorded
+	here, by descending once more, as most inserts do not split.
+
+	The rightmost leaf filled by a run of appends is split unevenly,
+	leaving the left leaf nearly full, as it will receive no more keys.
+	Its ancestors on the rightmost path are split the same way.
+	*/
+	const int length = leaf->getKeys()->size();
+	const bool append = leaf == rightmostLeaf && appendStreak >= (order - 1) / 2;
+	const int splitIndex = append ? std::max(length / 2, std::min(length - 1, static_cast<int>(length * appendSplitFraction))) : length / 2;
+	Key keyToParent;
+	LeafNode *right = leaf->split(&keyToParent, leafArena, splitIndex);
+	numLeaves.add(1);
+	numSplits.add(1);
+	structureVersion++;
+	if (leaf == rightmostLeaf) {
+		rightmostLeaf = right;
+		rightmostLow = keyToParent;
+		rightmostIsBounded = true;
 	}
+	insertInParent(key, leaf, keyToParent, right, append);
 }
 
-void Bplustree::insert(const int key, const std::vector<int> &values) {
-	std::stack<Node *> path;
-	findSearchPath(key, root, &path);
-	LeafNode *leaf = static_cast<LeafNode *>(path.top());
-	path.pop();
-	leaf->insert(key, values);
-	if (leaf->getKeys()->size() == order) {
-		int *keyToParent = new int;
-		Node *right = leaf->split(keyToParent);
-		if (path.empty()) {
-			InternalNode *newRoot = new InternalNode();
-			newRoot->insert(*keyToParent, leaf, right);
-			root = newRoot;
+template <typename Traits>
+void BasicBplustree<Traits>::insertInParent(const Key &key, Node *left, Key keyToParent, Node *right, const bool append) {
+	/*
+	Links right into the tree as the sibling following left, the leaf
+	key belongs in, splitting ancestors that overflow as a result.
+	*/
+	Node *path[maxHeight];
+	const int depth = findSearchPath(key, path);
+	insertInPath(path, depth, left, keyToParent, right, append);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insertInPath(Node **path, const int depth, Node *left, Key keyToParent, Node *right, const bool append) {
+	/*
+	As insertInParent, for left at the given depth of path, which holds
+	its ancestors from the root down.
+	*/
+	for (int level = depth - 1; level >= 0; level--) {
+		InternalNode *internal = static_cast<InternalNode *>(path[level]);
+		internal->insert(keyToParent, right);
+		if (internal->getKeys()->size() < internalOrder) {
 			return;
 		}
-		InternalNode *internal = static_cast<InternalNode *>(path.top());
-		path.pop();
-		internal->insert(*keyToParent, right);
-		while (internal->getKeys()->size() == order) {
-			right = internal->split(keyToParent);
-			if (!path.empty()) {
-				internal = static_cast<InternalNode *>(path.top());
-				path.pop();
-				internal->insert(*keyToParent, right);
-			}
-			else {
-				InternalNode *newRoot = new InternalNode();
-				newRoot->insert(*keyToParent, internal, right);
-				root = newRoot;
-				return;
-			}
-		}
-		delete keyToParent;
+		const int length = internal->getKeys()->size();
+		const int splitIndex = append ? std::max(length / 2, std::min(length - 2, static_cast<int>(length * appendSplitFraction))) : length / 2;
+		left = internal;
+		right = internal->split(&keyToParent, internalArena, splitIndex);
+		numInternalNodes.add(1);
+		numSplits.add(1);
 	}
-	else {
-		return;
+	InternalNode *newRoot = internalArena.newNode<InternalNode>();
+	newRoot->insert(keyToParent, left, right);
+	root = newRoot;
+	numInternalNodes.add(1);
+	height.add(1);
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::findSearchPath(const Key &key, Node **path) const {
+	/*
+	Fills path with the nodes from the root to the leaf key belongs in,
+	and returns the depth of the leaf.
+	*/
+	Node *node = root;
+	int depth = 0;
+	while (!node->isLeaf()) {
+		path[depth++] = node;
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		node = (*(internal->getChildren()))[internal->findChildIndex(key)];
 	}
+	path[depth] = node;
+	return depth;
 }
 
-bool Bplustree::update(const int key, const std::vector<int> &values, const bool insertIfNotFound) {
-	std::stack<Node *> path;
-	findSearchPath(key, root, &path);
-	LeafNode *leaf = static_cast<LeafNode *>(path.top());
-	if (insertIfNotFound) {
-		if (leaf->update(key, values)) {
-			return true;
+template <typename Traits>
+LeafNode<Traits> *BasicBplustree<Traits>::findInsertLeaf(const Key &key) {
+	/*
+	findLeaf for inserts. Keys at or past the lower bound of the
+	rightmost leaf go straight to the cached rightmost leaf, so ascending
+	keys skip the descent. The cache is rebuilt by descending along the
+	last children after changes that may have moved the rightmost leaf.
+	*/
+	if (!rightmostLeaf) {
+		Node *node = root;
+		rightmostIsBounded = false;
+		while (!node->isLeaf()) {
+			InternalNode *internal = static_cast<InternalNode *>(node);
+			rightmostLow = internal->getKeys()->back();
+			rightmostIsBounded = true;
+			node = internal->getChildren()->back();
 		}
-		else {
-			path.pop();
-			leaf->insert(key, values);
-			if (leaf->getKeys()->size() == order) {
-				int *keyToParent = new int;
-				Node *right = leaf->split(keyToParent);
-				if (path.empty()) {
-					InternalNode *newRoot = new InternalNode();
-					newRoot->insert(*keyToParent, leaf, right);
-					root = newRoot;
-					return true;
-				}
-				InternalNode *internal = static_cast<InternalNode *>(path.top());
-				path.pop();
-				internal->insert(*keyToParent, right);
-				while (internal->getKeys()->size() == order) {
-					right = internal->split(keyToParent);
-					if (!path.empty()) {
-						internal = static_cast<InternalNode *>(path.top());
-						path.pop();
-						internal->insert(*keyToParent, right);
-					}
-					else {
-						InternalNode *newRoot = new InternalNode();
-						newRoot->insert(*keyToParent, internal, right);
-						root = newRoot;
-						return true;
-					}
+		rightmostLeaf = static_cast<LeafNode *>(node);
+	}
+	if (rightmostIsBounded && Compare()(key, rightmostLow)) {
+		appendStreak = 0;
+		return findLeaf(key);
+	}
+	numAppends.add(1);
+	typename LeafNode::Keys *keys = rightmostLeaf->getKeys();
+	appendStreak = keys->empty() || Compare()(keys->back(), key) ? appendStreak + 1 : 0;
+	return rightmostLeaf;
+}
+
+template <typename Traits>
+LeafNode<Traits> *BasicBplustree<Traits>::findLeaf(const Key &key) const {
+	Node *node = root;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		node = (*(internal->getChildren()))[internal->findChildIndex(key)];
+	}
+	return static_cast<LeafNode *>(node);
+}
+
+template <typename Traits>
+LeafNode<Traits> *BasicBplustree<Traits>::findHintedLeaf(const Key &key, SearchHint *hint) const {
+	/*
+	findLeaf through a hint. A key within the bounds of the hinted leaf
+	is served without a descent. Otherwise up to maxHintWalk siblings
+	under the same parent are tried by following the leaf links, their
+	bounds read off the separators of the parent. Failing that, it
+	descends from the root and records the leaf reached in the hint.
+	*/
+	const Compare compare;
+	if (hint->tree == this && hint->version == structureVersion) {
+		for (int step = 0; ; step++) {
+			const bool belowLeaf = hint->hasLow && compare(key, hint->low);
+			const bool aboveLeaf = hint->hasHigh && !compare(key, hint->high);
+			if (!belowLeaf && !aboveLeaf) {
+				step == 0 ? hint->numHits++ : hint->numWalks++;
+				return hint->leaf;
+			}
+			if (step == maxHintWalk || !hint->parent) {
+				break;
+			}
+			typename InternalNode::Keys &separators = *(hint->parent->getKeys());
+			const int numSeparators = separators.size();
+			if (belowLeaf) {
+				if (hint->childIndex == 0) {
+					break;
 				}
-				delete keyToParent;
+				hint->childIndex--;
+				hint->leaf = hint->leaf->getPrev();
+				hint->high = hint->low;
+				hint->hasHigh = true;
+				hint->hasLow = hint->childIndex > 0 || hint->parentHasLow;
+				hint->low = hint->childIndex > 0 ? separators[hint->childIndex - 1] : hint->parentLow;
 			}
 			else {
-				return true;
+				if (hint->childIndex == numSeparators) {
+					break;
+				}
+				hint->childIndex++;
+				hint->leaf = hint->leaf->getNext();
+				hint->low = hint->high;
+				hint->hasLow = true;
+				hint->hasHigh = hint->childIndex < numSeparators || hint->parentHasHigh;
+				hint->high = hint->childIndex < numSeparators ? separators[hint->childIndex] : hint->parentHigh;
 			}
 		}
 	}
-	else {
-		return leaf->update(key, values);
+	hint->numDescents++;
+	hint->tree = this;
+	hint->version = structureVersion;
+	hint->parent = nullptr;
+	hint->childIndex = 0;
+	hint->hasLow = false;
+	hint->hasHigh = false;
+	Node *node = root;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		typename InternalNode::Keys &separators = *(internal->getKeys());
+		const int index = internal->findChildIndex(key);
+		hint->parent = internal;
+		hint->childIndex = index;
+		hint->parentLow = hint->low;
+		hint->parentHasLow = hint->hasLow;
+		hint->parentHigh = hint->high;
+		hint->parentHasHigh = hint->hasHigh;
+		if (index > 0) {
+			hint->low = separators[index - 1];
+			hint->hasLow = true;
+		}
+		if (index < separators.size()) {
+			hint->high = separators[index];
+			hint->hasHigh = true;
+		}
+		node = (*(internal->getChildren()))[index];
 	}
-	return true;
+	hint->leaf = static_cast<LeafNode *>(node);
+	return hint->leaf;
 }
 
-void Bplustree::findSearchPath(const int key, Node *node, std::stack<Node *> *path) {
-	path->push(node);
-	if (node->isLeaf()) {
-		return;
+template <typename Traits>
+LeafNode<Traits> *BasicBplustree<Traits>::findLeaf(const Key &key, Key *upperBound, bool *isBounded) const {
+	/*
+	As findLeaf, but also sets upperBound to the separator that ends the
+	key range of the leaf. isBounded is false for the rightmost leaf.
+	*/
+	Node *node = root;
+	*isBounded = false;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		const int index = internal->findChildIndex(key);
+		if (index < internal->getKeys()->size()) {
+			*upperBound = (*(internal->getKeys()))[index];
+			*isBounded = true;
+		}
+		node = (*(internal->getChildren()))[index];
 	}
-	std::vector<int> *keys = node->getKeys();
-	std::vector<int>::iterator low = std::lower_bound(keys->begin(), keys->end(), key);
-	InternalNode *internal = static_cast<InternalNode *>(node);
-	Node *nextNode = nullptr;
-	int index = low - keys->begin();
-	if (index < keys->size()) {
-		// Move to right child
-		if (key == (*keys)[index]) {
-			nextNode = (*(internal->getChildren()))[index + 1];
-		}
-		// Move to left child
+	return static_cast<LeafNode *>(node);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::insertBatch(const std::vector<Key> &keys, const std::vector<Value> &values) {
+	/*
+	Inserts the pairs as repeated calls to insert would, but descends
+	once per leaf reached instead of once per pair. The batch is sorted
+	on key, and each run of keys falling into the same leaf is merged
+	into it in one pass. A leaf that overflows is cut into as many
+	leaves as needed, each linked into the tree by insertInParent.
+	*/
+	throwIfFrozen();
+	if (keys.size() != values.size()) {
+		throw std::string("keys.size() and values.size() must be equal\n");
+	}
+	const Compare compare;
+	std::vector<std::pair<Key, Value>> pairs;
+	pairs.reserve(keys.size());
+	for (int i = 0; i < keys.size(); i++) {
+		pairs.emplace_back(keys[i], values[i]);
+	}
+	if (!std::is_sorted(keys.begin(), keys.end(), compare)) {
+		std::stable_sort(pairs.begin(), pairs.end(), [&compare](const std::pair<Key, Value> &a, const std::pair<Key, Value> &b) { return compare(a.first, b.first); });
+	}
+	std::vector<Key> mergedKeys;
+	std::vector<ValueSlot> mergedValues;
+	const std::pair<Key, Value> *next = pairs.data();
+	const std::pair<Key, Value> *end = pairs.data() + pairs.size();
+	while (next != end) {
+		Key upperBound;
+		bool isBounded;
+		LeafNode *leaf = findLeaf(next->first, &upperBound, &isBounded);
+		const std::pair<Key, Value> *runEnd = end;
+		if (isBounded) {
+			runEnd = std::lower_bound(next, end, upperBound, [&compare](const std::pair<Key, Value> &pair, const Key &key) { return compare(pair.first, key); });
+		}
+		mergeRun(leaf, next, runEnd, mergedKeys, mergedValues);
+		next = runEnd;
+	}
+	// Leaves may have been cut, including the rightmost one
+	rightmostLeaf = nullptr;
+	structureVersion++;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::mergeRun(LeafNode *leaf, const std::pair<Key, Value> *first, const std::pair<Key, Value> *last, std::vector<Key> &mergedKeys, std::vector<ValueSlot> &mergedValues) {
+	/*
+	Merges the sorted pairs [first, last), which all belong in leaf,
+	into it. Values of keys already present are appended to their slot.
+	mergedKeys and mergedValues are scratch space kept by the caller.
+	*/
+	const Compare compare;
+	const Key runKey = first->first;
+	typename LeafNode::Keys *leafKeys = leaf->getKeys();
+	typename LeafNode::Values *leafValues = leaf->getValues();
+	mergedKeys.clear();
+	mergedValues.clear();
+	int index = 0;
+	int numNewKeys = 0;
+	numValues.add(last - first);
+	while (index < leafKeys->size() || first != last) {
+		if (first == last || (index < leafKeys->size() && compare((*leafKeys)[index], first->first))) {
+			mergedKeys.push_back((*leafKeys)[index]);
+			mergedValues.push_back((*leafValues)[index]);
+			index++;
+			continue;
+		}
+		ValueSlot keyValues;
+		if (index < leafKeys->size() && !compare(first->first, (*leafKeys)[index])) {
+			keyValues = (*leafValues)[index];
+			index++;
+		}
 		else {
-			nextNode = (*(internal->getChildren()))[index];
+			numNewKeys++;
+		}
+		const Key key = first->first;
+		while (first != last && !compare(key, first->first)) {
+			keyValues.push_back(first->second, valueArena);
+			first++;
 		}
+		mergedKeys.push_back(key);
+		mergedValues.push_back(keyValues);
 	}
-	// Iterator found keys->end() i.e. last.
-	// Index is thus not valid in keys, but we should move to right child.
-	// Note that index correctly identifies the child without adding 1.
-	else {
-		nextNode = (*(internal->getChildren()))[index];
+	numKeys.add(numNewKeys);
+	const int numMerged = mergedKeys.size();
+	if (numMerged < order) {
+		leafKeys->assign(mergedKeys.begin(), mergedKeys.end());
+		leafValues->assign(mergedValues.begin(), mergedValues.end());
+		addToSubtreeCounts(runKey, numNewKeys);
+		return;
+	}
+	/*
+	Cuts the merged entries into the fewest leaves of at most order - 1
+	keys, evenly sized so that none underflows. Subtree counts are
+	raised by the keys of each piece before it is linked, while its keys
+	still route to the leaf on its left, so that every split in
+	insertInParent finds the counts below it exact.
+	*/
+	const int numPieces = (numMerged + order - 2) / (order - 1);
+	addToSubtreeCounts(runKey, numMerged / numPieces - (numMerged - numNewKeys));
+	LeafNode *left = leaf;
+	for (int piece = 0; piece < numPieces; piece++) {
+		const int pieceBegin = static_cast<long long>(numMerged) * piece / numPieces;
+		const int pieceEnd = static_cast<long long>(numMerged) * (piece + 1) / numPieces;
+		LeafNode *pieceLeaf = piece == 0 ? leaf : leafArena.newNode<LeafNode>();
+		pieceLeaf->getKeys()->assign(mergedKeys.begin() + pieceBegin, mergedKeys.begin() + pieceEnd);
+		pieceLeaf->getValues()->assign(mergedValues.begin() + pieceBegin, mergedValues.begin() + pieceEnd);
+		if (piece > 0) {
+			pieceLeaf->setPrev(left);
+			pieceLeaf->setNext(left->getNext());
+			left->getNext()->setPrev(pieceLeaf);
+			left->setNext(pieceLeaf);
+			numLeaves.add(1);
+			numSplits.add(1);
+			addToSubtreeCounts(mergedKeys[pieceBegin], pieceEnd - pieceBegin);
+			insertInParent(mergedKeys[pieceBegin], left, mergedKeys[pieceBegin], pieceLeaf, false);
+			left = pieceLeaf;
+		}
+	}
+}
+
+template <typename Traits>
+const typename BasicBplustree<Traits>::ValueSlot *BasicBplustree<Traits>::search(const Key &key) {
+	if (frozen) {
+		return frozen->search(key);
+	}
+	return findLeaf(key)->getValues(key);
+}
+
+template <typename Traits>
+const typename BasicBplustree<Traits>::ValueSlot *BasicBplustree<Traits>::search(const Key &key, SearchHint *hint) const {
+	if (frozen) {
+		return frozen->search(key);
 	}
-	findSearchPath(key, nextNode, path);
+	return findHintedLeaf(key, hint)->getValues(key);
 }
 
-const std::vector<int> *Bplustree::search(const int key) {
-	std::stack<Node *> path;
-	findSearchPath(key, root, &path);
-	LeafNode *leaf = static_cast<LeafNode *>(path.top());
-	return leaf->getValues(key);
+template <typename T>
+static inline void prefetchNode(const T *node) {
+	/*
+	Prefetches the first cache lines of a node, which hold its header and,
+	for fixed layouts, the keys a search touches first.
+	*/
+	const char *bytes = reinterpret_cast<const char *>(node);
+	for (std::size_t offset = 0; offset < std::min<std::size_t>(sizeof(T), 256); offset += 64) {
+		__builtin_prefetch(bytes + offset);
+	}
 }
 
-std::map<int, std::vector<int>> Bplustree::scan(const int start, const int end) {
-	std::stack<Node *> path;
-	findSearchPath(start, root, &path);
-	LeafNode *startLeaf = static_cast<LeafNode *>(path.top());
-	std::map<int, std::vector<int>> result;
+template <typename Traits>
+void BasicBplustree<Traits>::multiSearch(const std::vector<Key> &keys, std::vector<const ValueSlot *> &results, const int groupSize) const {
+	/*
+	Searches the keys in groups, moving every lookup of a group down one
+	level before any goes further. The next node of each lookup is
+	prefetched as soon as it is known, so the cache misses of a group
+	overlap instead of being taken one after the other. Runtime order
+	nodes keep their keys out of line, so those are prefetched in a
+	second pass once the nodes have arrived.
+	*/
+	results.resize(keys.size());
+	if (frozen) {
+		for (std::size_t i = 0; i < keys.size(); i++) {
+			results[i] = frozen->search(keys[i]);
+		}
+		return;
+	}
+	const int group = std::clamp(groupSize, 1, maxGroupSize);
+	const int numLevels = height.get();
+	Node *nodes[maxGroupSize];
+	for (std::size_t first = 0; first < keys.size(); first += group) {
+		const int count = std::min<std::size_t>(group, keys.size() - first);
+		const Key *groupKeys = keys.data() + first;
+		for (int i = 0; i < count; i++) {
+			nodes[i] = root;
+		}
+		for (int level = 1; level < numLevels; level++) {
+			const bool childIsLeaf = level == numLevels - 1;
+			for (int i = 0; i < count; i++) {
+				InternalNode *internal = static_cast<InternalNode *>(nodes[i]);
+				nodes[i] = (*(internal->getChildren()))[internal->findChildIndex(groupKeys[i])];
+				childIsLeaf ? prefetchNode(static_cast<LeafNode *>(nodes[i])) : prefetchNode(static_cast<InternalNode *>(nodes[i]));
+			}
+			if (!Traits::fixedLayout) {
+				for (int i = 0; i < count; i++) {
+					__builtin_prefetch(childIsLeaf ? static_cast<LeafNode *>(nodes[i])->getKeys()->data() : static_cast<InternalNode *>(nodes[i])->getKeys()->data());
+				}
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			results[first + i] = static_cast<LeafNode *>(nodes[i])->getValues(groupKeys[i]);
+		}
+	}
+}
+
+template <typename Traits>
+typename BasicBplustree<Traits>::ScanResult BasicBplustree<Traits>::scan(const Key &start, const Key &end) {
+	ScanResult result;
+	if (frozen) {
+		const Key *keys = frozen->getKeys();
+		const ValueSlot *values = frozen->getValues();
+		for (int i = frozen->lowerBound(start); i < frozen->size() && !Compare()(end, keys[i]); i++) {
+			result.emplace_hint(result.end(), keys[i], std::vector<Value>(values[i].begin(), values[i].end()));
+		}
+		return result;
+	}
+	LeafNode *startLeaf = findLeaf(start);
 	LeafNode *leaf = startLeaf->scan(start, end, startLeaf, result);
 	while (leaf) {
 		leaf = leaf->scan(start, end, startLeaf, result);
@@ -188,9 +544,18 @@ std::map<int, std::vector<int>> Bplustree::scan(const int start, const int end)
 	return result;
 }
 
-std::map<int, std::vector<int>> Bplustree::scanFull() {
+template <typename Traits>
+typename BasicBplustree<Traits>::ScanResult BasicBplustree<Traits>::scanFull() {
+	ScanResult result;
+	if (frozen) {
+		const Key *keys = frozen->getKeys();
+		const ValueSlot *values = frozen->getValues();
+		for (int i = 0; i < frozen->size(); i++) {
+			result.emplace_hint(result.end(), keys[i], std::vector<Value>(values[i].begin(), values[i].end()));
+		}
+		return result;
+	}
 	LeafNode *startLeaf = getLeftLeaf();
-	std::map<int, std::vector<int>> result;
 	LeafNode *leaf = startLeaf->scanFull(result);
 	while (startLeaf != leaf) {
 		leaf = leaf->scanFull(result);
@@ -198,7 +563,60 @@ std::map<int, std::vector<int>> Bplustree::scanFull() {
 	return result;
 }
 
-LeafNode *Bplustree::getLeftLeaf() {
+template <typename Traits>
+BasicCursor<Traits> BasicBplustree<Traits>::getCursor() const {
+	return Cursor(this);
+}
+
+template <typename Traits>
+std::vector<typename BasicBplustree<Traits>::ScanPartition> BasicBplustree<Traits>::getScanPartitions(const Key &start, const Key &end, const int minPartitions) const {
+	/*
+	Splits [start, end] into consecutive key ranges on the separator keys
+	of the root, or on those of the second level if the root gives fewer
+	than minPartitions ranges. Each range then covers a run of leaves.
+	A frozen tree is split on evenly spaced keys of its image instead.
+	*/
+	const Compare compare;
+	std::vector<Key> separators;
+	if (frozen) {
+		const long long numPartitions = 4 * minPartitions;
+		for (long long i = 1; i < numPartitions && frozen->size() > 0; i++) {
+			separators.push_back(frozen->getKeys()[i * frozen->size() / numPartitions]);
+		}
+	}
+	else if (!root->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(root);
+		typename InternalNode::Keys *keys = internal->getKeys();
+		typename InternalNode::Children *children = internal->getChildren();
+		separators.assign(keys->begin(), keys->end());
+		if (separators.size() + 1 < minPartitions && !(*children)[0]->isLeaf()) {
+			separators.clear();
+			for (int i = 0; i < children->size(); i++) {
+				if (i > 0) {
+					separators.push_back((*keys)[i - 1]);
+				}
+				typename InternalNode::Keys *childKeys = static_cast<InternalNode *>((*children)[i])->getKeys();
+				separators.insert(separators.end(), childKeys->begin(), childKeys->end());
+			}
+		}
+	}
+	std::vector<ScanPartition> partitions;
+	if (compare(end, start)) {
+		return partitions;
+	}
+	Key low = start;
+	for (const Key &separator : separators) {
+		if (compare(low, separator) && !compare(end, separator)) {
+			partitions.push_back({low, separator, false});
+			low = separator;
+		}
+	}
+	partitions.push_back({low, end, true});
+	return partitions;
+}
+
+template <typename Traits>
+LeafNode<Traits> *BasicBplustree<Traits>::getLeftLeaf() const {
 	Node *node = root;
 	while (!node->isLeaf()) {
 		InternalNode *internal = static_cast<InternalNode *>(node);
@@ -207,130 +625,633 @@ LeafNode *Bplustree::getLeftLeaf() {
 	return static_cast<LeafNode *>(node);
 }
 
-bool Bplustree::remove(const int key) {
+template <typename Traits>
+bool BasicBplustree<Traits>::getKeyBounds(Key *first, Key *last) const {
 	/*
-	Database Management Systems, 3rd Edition pp. 352-356
-	used as guideline.
+	Sets first and last to the smallest and largest key stored, and
+	returns false if the tree is empty.
 	*/
-	int *oldChildEntry = nullptr;
-	return remove(nullptr, root, key, oldChildEntry);
+	if (frozen) {
+		if (frozen->size() == 0) {
+			return false;
+		}
+		*first = frozen->getKeys()[0];
+		*last = frozen->getKeys()[frozen->size() - 1];
+		return true;
+	}
+	LeafNode *leftLeaf = getLeftLeaf();
+	if (leftLeaf->getKeys()->empty()) {
+		return false;
+	}
+	*first = leftLeaf->getKeys()->front();
+	*last = leftLeaf->getPrev()->getKeys()->back();
+	return true;
 }
 
-bool Bplustree::remove(InternalNode *parent, Node *node, const int key, int *&oldChildEntry) {
-	if (!node->isLeaf()) {
+template <typename Traits>
+bool BasicBplustree<Traits>::remove(const Key &key) {
+	/*
+	Database Management Systems, 3rd Edition pp. 352-356
+	used as guideline.
+
+	The path of internal nodes and the index of the child taken in
+	each is recorded on the way down, so that underflow can be
+	resolved bottom-up without searching parents for their children.
+	*/
+	throwIfFrozen();
+	InternalNode *path[maxHeight];
+	int childIndexes[maxHeight];
+	int depth = 0;
+	Node *node = root;
+	while (!node->isLeaf()) {
 		InternalNode *internal = static_cast<InternalNode *>(node);
-		std::vector<int> *keys = internal->getKeys();
-		std::vector<int>::iterator low = std::lower_bound(keys->begin(), keys->end(), key);
-		int index = low - keys->begin();
-		Node *nextNode = nullptr;
-		if (index < keys->size()) {
-			if (key == (*keys)[index]) {
-				nextNode = (*(internal->getChildren()))[index + 1];
-			}
-			else {
-				nextNode = (*(internal->getChildren()))[index];
-			}
+		path[depth] = internal;
+		childIndexes[depth] = internal->findChildIndex(key);
+		node = (*(internal->getChildren()))[childIndexes[depth]];
+		depth++;
+	}
+	LeafNode *leaf = static_cast<LeafNode *>(node);
+	const bool leafHadExtraEntries = leaf->hasExtraEntries(order, root);
+	int numOldValues;
+	bool keyWasRemoved = leaf->remove(key, valueArena, &numOldValues);
+	// key is not present in tree so we can return
+	if (!keyWasRemoved) {
+		return false;
+	}
+	numKeys.add(-1);
+	numValues.add(-numOldValues);
+	if (subtreeCounts) {
+		for (int level = 0; level < depth; level++) {
+			(*(path[level]->getCounts()))[childIndexes[level]]--;
+		}
+	}
+	if (leafHadExtraEntries) {
+		return true;
+	}
+	// In relaxed mode only a leaf left empty is rebalanced, sparse ones wait for compact()
+	if (relaxedRemoves && !leaf->getKeys()->empty()) {
+		numDeferredRemoves.add(1);
+		return true;
+	}
+	rightmostLeaf = nullptr;
+	structureVersion++;
+	int oldChildEntry;
+	{
+		InternalNode *parent = path[depth - 1];
+		auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(childIndexes[depth - 1], order, root);
+		LeafNode *leafSibling = static_cast<LeafNode *>(sibling);
+		if (sibling->hasExtraEntries(order, root)) {
+			parent->redistribute(leaf, leafSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
+			numRedistributions.add(1);
+			return true;
+		}
+		oldChildEntry = splittingKeyIndex;
+		numLeaves.add(-1);
+		numMerges.add(1);
+		if (siblingIsOnRHS) {
+			leaf->merge(leafSibling, leafArena);
 		}
 		else {
-			nextNode = (*(internal->getChildren()))[index];
+			leafSibling->merge(leaf, leafArena);
+		}
+	}
+	for (int level = depth - 1; level >= 0; level--) {
+		InternalNode *internal = path[level];
+		internal->removeByKeyIndex(oldChildEntry);
+		if (!internal->hasUnderflow(internalOrder, root)) {
+			return true;
 		}
-		bool didRemove = remove(internal, nextNode, key, oldChildEntry);
-		if (!oldChildEntry) {
-			return didRemove;
+		if (internal == root) {
+			root = (*(internal->getChildren()))[0];
+			internalArena.deleteNode(internal);
+			numInternalNodes.add(-1);
+			height.add(-1);
+			return true;
+		}
+		InternalNode *parent = path[level - 1];
+		auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(childIndexes[level - 1], internalOrder, root);
+		InternalNode *internalSibling = static_cast<InternalNode *>(sibling);
+		if (internalSibling->hasExtraEntries(internalOrder, root)) {
+			parent->redistribute(internal, internalSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
+			numRedistributions.add(1);
+			return true;
+		}
+		oldChildEntry = splittingKeyIndex;
+		numInternalNodes.add(-1);
+		numMerges.add(1);
+		if (siblingIsOnRHS) {
+			internal->merge(internalSibling, splittingKey, internalArena);
 		}
 		else {
-			internal->removeByKeyIndex(*oldChildEntry);
-			delete oldChildEntry;
-			oldChildEntry = nullptr;
-			if (!internal->hasUnderflow(order, root)) {
-				return didRemove;
+			internalSibling->merge(internal, splittingKey, internalArena);
+		}
+	}
+	return true;
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::removeRange(const Key &start, const Key &end) {
+	/*
+	Removes all keys from start up to end and returns how many there
+	were. Subtrees lying wholly inside the range are unlinked and handed
+	back to the arenas without being searched or rebalanced. Only the
+	leaves holding start and end are trimmed, and underflow is repaired
+	along the two paths leading to them.
+	*/
+	throwIfFrozen();
+	if (Compare()(end, start)) {
+		return 0;
+	}
+	const long long oldNumKeys = numKeys.get();
+	LeafNode *startLeaf = findLeaf(start);
+	LeafNode *endLeaf = findLeaf(end);
+	// The leaves in between are dropped with their subtrees
+	if (startLeaf != endLeaf) {
+		startLeaf->setNext(endLeaf);
+		endLeaf->setPrev(startLeaf);
+	}
+	trimRange(root, start, end, true, true);
+	repairPath(start);
+	repairPath(end);
+	rightmostLeaf = nullptr;
+	structureVersion++;
+	return oldNumKeys - numKeys.get();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::trimRange(Node *node, const Key &start, const Key &end, const bool startInside, const bool endInside) {
+	/*
+	Removes the keys from start up to end below node, where startInside
+	and endInside tell whether either end falls within the key range of
+	node. The children lying wholly inside the range are dropped along
+	with the separators between them, so that the children holding
+	start and end become neighbours. Only these are trimmed recursively,
+	and are left for repairPath, possibly empty or with a single child
+	of their own.
+	*/
+	if (node->isLeaf()) {
+		int numOldValues;
+		numKeys.add(-static_cast<LeafNode *>(node)->removeRange(start, end, valueArena, &numOldValues));
+		numValues.add(-numOldValues);
+		return;
+	}
+	InternalNode *internal = static_cast<InternalNode *>(node);
+	typename InternalNode::Keys *keys = internal->getKeys();
+	typename InternalNode::Children *children = internal->getChildren();
+	typename InternalNode::Counts *counts = internal->getCounts();
+	// Children first + 1 to last - 1 are covered, first or last may lie past the ends
+	int first = startInside ? internal->findChildIndex(start) : -1;
+	int last = endInside ? internal->findChildIndex(end) : children->size();
+	if (last - first > 1) {
+		for (int i = first + 1; i < last; i++) {
+			dropSubtree((*children)[i]);
+		}
+		children->erase(children->begin() + first + 1, children->begin() + last);
+		counts->erase(counts->begin() + first + 1, counts->begin() + last);
+		// As many separators go as children, the one left of the first covered child if there is one
+		const int firstKey = std::max(first, 0);
+		keys->erase(keys->begin() + firstKey, keys->begin() + firstKey + last - first - 1);
+		last = first + 1;
+	}
+	if (startInside) {
+		trimRange((*children)[first], start, end, true, first == last && endInside);
+		(*counts)[first] = (*children)[first]->getNumSubtreeKeys();
+	}
+	if (endInside && last != first) {
+		trimRange((*children)[last], start, end, false, true);
+		(*counts)[last] = (*children)[last]->getNumSubtreeKeys();
+	}
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::repairPath(const Key &key) {
+	/*
+	Repairs the nodes trimmed by removeRange on the path to key
+	bottom-up, as remove does, so that a node losing a child to a merge
+	is checked in turn against its own siblings: a child left empty is
+	dropped, an underflowing one is redistributed or merged. A node with
+	a single child cannot repair it until the node itself has been
+	merged or refilled from the level above, so in that case the path
+	is recorded and walked again. A root left with a single child is
+	replaced by it.
+	*/
+	bool restart = true;
+	while (true) {
+		while (!root->isLeaf() && static_cast<InternalNode *>(root)->getChildren()->size() == 1) {
+			InternalNode *oldRoot = static_cast<InternalNode *>(root);
+			root = (*(oldRoot->getChildren()))[0];
+			internalArena.deleteNode(oldRoot);
+			numInternalNodes.add(-1);
+			height.add(-1);
+		}
+		if (!restart) {
+			return;
+		}
+		restart = false;
+		InternalNode *path[maxHeight];
+		int childIndexes[maxHeight];
+		int depth = 0;
+		Node *node = root;
+		while (!node->isLeaf()) {
+			InternalNode *internal = static_cast<InternalNode *>(node);
+			path[depth] = internal;
+			childIndexes[depth] = internal->findChildIndex(key);
+			node = (*(internal->getChildren()))[childIndexes[depth]];
+			depth++;
+		}
+		for (int level = depth - 1; level >= 0; level--) {
+			InternalNode *internal = path[level];
+			if (internal->getChildren()->size() < 2) {
+				restart = restart || internal != root;
+				continue;
 			}
-			else {
-				if (internal == root) {
-					root = (*(internal->getChildren()))[0];
-					delete internal;
-					return didRemove;
-				}
-				auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(internal, order, root);
-				InternalNode *internalSibling = static_cast<InternalNode *>(sibling);
-				if (internalSibling->hasExtraEntries(order, root)) {
-					parent->redistribute(internal, internalSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
-					return didRemove;
-				}
-				else {
-					oldChildEntry = new int;
-					*oldChildEntry = splittingKeyIndex;
-					if (siblingIsOnRHS) {
-						internal->merge(internalSibling, splittingKey);
-						return didRemove;
-					}
-					else {
-						internalSibling->merge(internal, splittingKey);
-						return didRemove;
-					}
-				}
+			if (isEmptySubtree((*(internal->getChildren()))[childIndexes[level]])) {
+				dropEmptyChild(internal, childIndexes[level]);
+				continue;
 			}
+			repairChild(internal, childIndexes[level]);
 		}
 	}
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::isEmptySubtree(Node *node) const {
+	while (!node->isLeaf()) {
+		typename InternalNode::Children *children = static_cast<InternalNode *>(node)->getChildren();
+		if (children->size() != 1) {
+			return false;
+		}
+		node = (*children)[0];
+	}
+	return static_cast<LeafNode *>(node)->getKeys()->empty();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::dropEmptyChild(InternalNode *parent, const int index) {
+	/*
+	Unlinks the leaf of an empty subtree from the leaf chain, drops the
+	subtree and removes it from parent along with a separator next to it.
+	*/
+	typename InternalNode::Children *children = parent->getChildren();
+	Node *child = (*children)[index];
+	Node *node = child;
+	while (!node->isLeaf()) {
+		node = (*(static_cast<InternalNode *>(node)->getChildren()))[0];
+	}
+	LeafNode *leaf = static_cast<LeafNode *>(node);
+	leaf->getPrev()->setNext(leaf->getNext());
+	leaf->getNext()->setPrev(leaf->getPrev());
+	dropSubtree(child);
+	if (index > 0) {
+		parent->removeByKeyIndex(index - 1);
+	}
 	else {
+		children->erase(children->begin());
+		parent->getCounts()->erase(parent->getCounts()->begin());
+		parent->getKeys()->erase(parent->getKeys()->begin());
+	}
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::dropSubtree(Node *node) {
+	/*
+	Hands a subtree unlinked by removeRange back to the arenas,
+	releasing the spilled values of its leaves on the way.
+	*/
+	if (node->isLeaf()) {
 		LeafNode *leaf = static_cast<LeafNode *>(node);
-		oldChildEntry = nullptr;
-		if (leaf->hasExtraEntries(order, root)) {
-			return leaf->remove(key);
+		long long numOldValues = 0;
+		for (ValueSlot &slot : *(leaf->getValues())) {
+			numOldValues += slot.size();
+			slot.release(valueArena);
+		}
+		numKeys.add(-leaf->getNumKeys());
+		numValues.add(-numOldValues);
+		numLeaves.add(-1);
+		leafArena.deleteNode(leaf);
+		return;
+	}
+	InternalNode *internal = static_cast<InternalNode *>(node);
+	for (Node *child : *(internal->getChildren())) {
+		dropSubtree(child);
+	}
+	numInternalNodes.add(-1);
+	internalArena.deleteNode(internal);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::repairChild(InternalNode *parent, const int index) {
+	/*
+	Resolves underflow of the child at index by redistribution with or
+	merge into a sibling, as remove does. A trimmed child may lack more
+	entries than a sibling can spare, so unlike remove the two are
+	merged whenever they fit into one node, and entries are only
+	redistributed when they are too many for one, which leaves both at
+	least at minimum occupancy. A child without siblings is left to the
+	level above. In relaxed mode underfull leaves are left for
+	compact().
+	*/
+	if (parent->getChildren()->size() < 2) {
+		return;
+	}
+	Node *child = (*(parent->getChildren()))[index];
+	if (child->isLeaf()) {
+		LeafNode *leaf = static_cast<LeafNode *>(child);
+		if (!leaf->hasUnderflow(order, root)) {
+			return;
+		}
+		if (relaxedRemoves && !leaf->getKeys()->empty()) {
+			numDeferredRemoves.add(1);
+			return;
+		}
+		auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(index, order, root);
+		LeafNode *leafSibling = static_cast<LeafNode *>(sibling);
+		if (leaf->getKeys()->size() + leafSibling->getKeys()->size() >= order) {
+			parent->redistribute(leaf, leafSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
+			numRedistributions.add(1);
+			return;
+		}
+		numLeaves.add(-1);
+		numMerges.add(1);
+		if (siblingIsOnRHS) {
+			leaf->merge(leafSibling, leafArena);
 		}
 		else {
-			bool keyWasRemoved = leaf->remove(key);
-			// key is not present in tree so we can return
-			if (!keyWasRemoved) {
-				return false;
-			}
-			auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(leaf, order, root);
-			LeafNode *leafSibling = static_cast<LeafNode *>(sibling);
-			if (sibling->hasExtraEntries(order, root)) {
-				parent->redistribute(leaf, leafSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
-				return true;
+			leafSibling->merge(leaf, leafArena);
+		}
+		parent->removeByKeyIndex(splittingKeyIndex);
+		return;
+	}
+	InternalNode *internal = static_cast<InternalNode *>(child);
+	if (!internal->hasUnderflow(internalOrder, root)) {
+		return;
+	}
+	auto [sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex] = parent->getSibling(index, internalOrder, root);
+	InternalNode *internalSibling = static_cast<InternalNode *>(sibling);
+	// The separator moves down into a merged node
+	if (internal->getKeys()->size() + internalSibling->getKeys()->size() + 1 >= internalOrder) {
+		parent->redistribute(internal, internalSibling, siblingIsOnRHS, splittingKey, splittingKeyIndex);
+		numRedistributions.add(1);
+		return;
+	}
+	numInternalNodes.add(-1);
+	numMerges.add(1);
+	if (siblingIsOnRHS) {
+		internal->merge(internalSibling, splittingKey, internalArena);
+	}
+	else {
+		internalSibling->merge(internal, splittingKey, internalArena);
+	}
+	parent->removeByKeyIndex(splittingKeyIndex);
+}
+
+template <typename Traits>
+BasicBplustree<Traits> *BasicBplustree<Traits>::splitAt(const Key &key) {
+	/*
+	Moves all keys from key on into a new tree, owned by the caller, and
+	returns it. The nodes on the path to key are cut in two, the right
+	halves forming the left edge of the new tree, which takes over all
+	nodes right of the path as they are. The new tree then shares the
+	slabs of this one. The right edge of this tree and the left edge of
+	the new one are each a root-to-leaf path of cut nodes, and each is
+	repaired bottom-up as after removeRange. Only the statistics of the
+	new tree are counted by a walk over its nodes.
+	*/
+	throwIfFrozen();
+	BasicBplustree *right = new BasicBplustree(order, useHugePages);
+	right->relaxedRemoves = relaxedRemoves;
+	right->subtreeCounts = subtreeCounts;
+	right->leafArena.deleteNode(right->root);
+	LeafNode *leftFirst = getLeftLeaf();
+	LeafNode *leftLast = leftFirst->getPrev();
+	LeafNode *cutLeaf = findLeaf(key);
+	LeafNode *cutNext = cutLeaf->getNext();
+	right->root = cutRight(root, key, right);
+	// The leaves from the right half of the cut leaf on form the chain of the new tree
+	LeafNode *rightFirst = right->getLeftLeaf();
+	if (cutLeaf == leftLast) {
+		rightFirst->setNext(rightFirst);
+		rightFirst->setPrev(rightFirst);
+	}
+	else {
+		rightFirst->setNext(cutNext);
+		cutNext->setPrev(rightFirst);
+		rightFirst->setPrev(leftLast);
+		leftLast->setNext(rightFirst);
+	}
+	cutLeaf->setNext(leftFirst);
+	leftFirst->setPrev(cutLeaf);
+	TreeStats moved = {};
+	std::size_t movedValueBytes = 0;
+	countSubtree(right->root, &moved, &movedValueBytes);
+	// The right halves of the cut nodes were allocated by the new tree
+	leafArena.moveSlots(right->leafArena, moved.numLeaves - 1);
+	internalArena.moveSlots(right->internalArena, moved.numInternalNodes - (height.get() - 1));
+	valueArena.moveBytes(right->valueArena, movedValueBytes);
+	right->numKeys.set(moved.numKeys);
+	right->numValues.set(moved.numValues);
+	right->numLeaves.set(moved.numLeaves);
+	right->numInternalNodes.set(moved.numInternalNodes);
+	right->height.set(height.get());
+	numKeys.add(-moved.numKeys);
+	numValues.add(-moved.numValues);
+	numLeaves.add(-(moved.numLeaves - 1));
+	numInternalNodes.add(-(moved.numInternalNodes - (height.get() - 1)));
+	// key leads along the right edge of this tree and the left edge of the new one
+	repairPath(key);
+	right->repairPath(key);
+	rightmostLeaf = nullptr;
+	appendStreak = 0;
+	structureVersion++;
+	return right;
+}
+
+template <typename Traits>
+Node<Traits> *BasicBplustree<Traits>::cutRight(Node *node, const Key &key, BasicBplustree *right) {
+	/*
+	Cuts node before key, keeping the entries less than key, and returns
+	a new node of right holding the rest.
+	*/
+	if (node->isLeaf()) {
+		LeafNode *leaf = static_cast<LeafNode *>(node);
+		typename LeafNode::Keys *keys = leaf->getKeys();
+		typename LeafNode::Values *values = leaf->getValues();
+		const int index = keyRankSearch<Key, Compare>(keys->data(), keys->size(), key);
+		LeafNode *cut = right->leafArena.template newNode<LeafNode>();
+		cut->getKeys()->assign(keys->begin() + index, keys->end());
+		keys->erase(keys->begin() + index, keys->end());
+		cut->getValues()->assign(values->begin() + index, values->end());
+		values->erase(values->begin() + index, values->end());
+		return cut;
+	}
+	InternalNode *internal = static_cast<InternalNode *>(node);
+	typename InternalNode::Keys *keys = internal->getKeys();
+	typename InternalNode::Children *children = internal->getChildren();
+	typename InternalNode::Counts *counts = internal->getCounts();
+	const int index = internal->findChildIndex(key);
+	Node *cutChild = cutRight((*children)[index], key, right);
+	InternalNode *cut = right->internalArena.template newNode<InternalNode>();
+	cut->getKeys()->assign(keys->begin() + index, keys->end());
+	keys->erase(keys->begin() + index, keys->end());
+	cut->getChildren()->push_back(cutChild);
+	cut->getChildren()->insert(cut->getChildren()->end(), children->begin() + index + 1, children->end());
+	children->erase(children->begin() + index + 1, children->end());
+	cut->getCounts()->push_back(cutChild->getNumSubtreeKeys());
+	cut->getCounts()->insert(cut->getCounts()->end(), counts->begin() + index + 1, counts->end());
+	counts->erase(counts->begin() + index + 1, counts->end());
+	(*counts)[index] = (*children)[index]->getNumSubtreeKeys();
+	return cut;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::countSubtree(Node *node, TreeStats *stats, std::size_t *valueBytes) const {
+	/*
+	Adds the keys, values, leaves and internal nodes below node to stats,
+	and the bytes of its spilled value blocks to valueBytes.
+	*/
+	if (node->isLeaf()) {
+		LeafNode *leaf = static_cast<LeafNode *>(node);
+		for (const ValueSlot &slot : *(leaf->getValues())) {
+			stats->numValues += slot.size();
+			*valueBytes += slot.getBlockBytes();
+		}
+		stats->numKeys += leaf->getNumKeys();
+		stats->numLeaves++;
+		return;
+	}
+	stats->numInternalNodes++;
+	for (Node *child : *(static_cast<InternalNode *>(node)->getChildren())) {
+		countSubtree(child, stats, valueBytes);
+	}
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::concat(BasicBplustree &other) {
+	/*
+	Moves all entries of other, whose keys must all be greater than those
+	of this tree, to the end of this tree and leaves other empty. The
+	root of the lower tree is linked in as a child of the node one level
+	above it on the facing edge of the higher tree, splitting ancestors
+	that overflow as an insert does, and the seam is repaired as after
+	removeRange. Nodes stay where they are, this tree takes over the
+	slabs of other.
+	*/
+	throwIfFrozen();
+	other.throwIfFrozen();
+	if (&other == this || other.order != order) {
+		throw std::string("only a different tree of the same order can be concatenated\n");
+	}
+	Key first, last, otherFirst, otherLast;
+	const bool isEmpty = !getKeyBounds(&first, &last);
+	if (!other.getKeyBounds(&otherFirst, &otherLast)) {
+		return;
+	}
+	if (!isEmpty && !Compare()(last, otherFirst)) {
+		throw std::string("keys of a concatenated tree must all be greater than those of this tree\n");
+	}
+	if (subtreeCounts && !other.subtreeCounts) {
+		other.recountSubtree(other.root);
+	}
+	const long long oldNumKeys = numKeys.get();
+	other.leafArena.moveSlots(leafArena, other.numLeaves.get());
+	other.internalArena.moveSlots(internalArena, other.numInternalNodes.get());
+	other.valueArena.moveBytes(valueArena, other.valueArena.getBytesInUse());
+	numKeys.add(other.numKeys.get());
+	numValues.add(other.numValues.get());
+	numLeaves.add(other.numLeaves.get());
+	numInternalNodes.add(other.numInternalNodes.get());
+	numDeferredRemoves.add(other.numDeferredRemoves.get());
+	if (isEmpty) {
+		leafArena.deleteNode(root);
+		numLeaves.add(-1);
+		root = other.root;
+		height.set(other.height.get());
+	}
+	else {
+		LeafNode *leftFirst = getLeftLeaf();
+		LeafNode *leftLast = leftFirst->getPrev();
+		LeafNode *rightFirst = other.getLeftLeaf();
+		LeafNode *rightLast = rightFirst->getPrev();
+		leftLast->setNext(rightFirst);
+		rightFirst->setPrev(leftLast);
+		rightLast->setNext(leftFirst);
+		leftFirst->setPrev(rightLast);
+		const int leftHeight = height.get();
+		const int rightHeight = other.height.get();
+		Node *path[maxHeight];
+		if (leftHeight >= rightHeight) {
+			// The right edge of this tree, where the root of other becomes the last child
+			findSearchPath(otherFirst, path);
+			const int depth = leftHeight - rightHeight;
+			for (int level = 0; subtreeCounts && level < depth - 1; level++) {
+				static_cast<InternalNode *>(path[level])->getCounts()->back() += other.numKeys.get();
 			}
-			else {
-				oldChildEntry = new int;
-				*oldChildEntry = splittingKeyIndex;
-				if (siblingIsOnRHS) {
-					leaf->merge(leafSibling);
-					return true;
-				}
-				else {
-					leafSibling->merge(leaf);
-					return true;
-				}
+			insertInPath(path, depth, path[depth], otherFirst, other.root, false);
+		}
+		else {
+			// The left edge of other, where the root of this tree takes the place of the first child
+			other.findSearchPath(otherFirst, path);
+			const int depth = rightHeight - leftHeight;
+			for (int level = 0; subtreeCounts && level < depth - 1; level++) {
+				static_cast<InternalNode *>(path[level])->getCounts()->front() += oldNumKeys;
 			}
+			Node *displaced = path[depth];
+			Node *oldRoot = root;
+			(*(static_cast<InternalNode *>(path[depth - 1])->getChildren()))[0] = oldRoot;
+			root = other.root;
+			height.set(rightHeight);
+			insertInPath(path, depth, oldRoot, otherFirst, displaced, false);
 		}
+		repairPath(last);
+		repairPath(otherFirst);
 	}
+	other.root = other.leafArena.template newNode<LeafNode>();
+	other.numKeys.set(0);
+	other.numValues.set(0);
+	other.height.set(1);
+	other.numLeaves.set(1);
+	other.numInternalNodes.set(0);
+	other.numDeferredRemoves.set(0);
+	other.rightmostLeaf = nullptr;
+	other.appendStreak = 0;
+	other.structureVersion++;
+	rightmostLeaf = nullptr;
+	appendStreak = 0;
+	structureVersion++;
 }
 
-void Bplustree::show() {
+template <typename Traits>
+void BasicBplustree<Traits>::show() {
 	/*
 	Method that prints the current tree.
 	Inspired by: github.com/EmilianoCarrillo/BTree-Pretty-Print
 	*/
+	if (frozen) {
+		std::cout << "Frozen tree of " << frozen->size() << " keys in " << frozen->getNumLevels() << " levels\n";
+		return;
+	}
 	std::vector<int> parentKeyLengths;
 	printTree(root, 0, "", &parentKeyLengths);
 }
 
-void Bplustree::printTree(Node *node, const int printLevel, std::string prevString, const std::vector<int> *parentKeyLengths) {
+template <typename Traits>
+void BasicBplustree<Traits>::printTree(Node *node, const int printLevel, std::string prevString, const std::vector<int> *parentKeyLengths) {
 	std::string baseString = prevString;
 	prevString = printNode(node, printLevel, baseString, parentKeyLengths);
 	if (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
 		std::vector<int> parentKeyLengthsToPass;
-		for (int i = 0; i < node->getKeys()->size(); i++) {
-			parentKeyLengthsToPass.push_back(std::to_string((*(node->getKeys()))[i]).length());
+		for (int i = 0; i < internal->getKeys()->size(); i++) {
+			parentKeyLengthsToPass.push_back(keyToString((*(internal->getKeys()))[i]).length());
 		}
-		InternalNode *internal = static_cast<InternalNode *>(node);
 		for (int i = internal->getChildren()->size() - 1; i >= 0; i--) {
 			printTree((*(internal->getChildren()))[i], i, prevString, &parentKeyLengthsToPass);
 		}
 	}
 }
 
-std::string Bplustree::printNode(Node *node, const int printLevel, std::string prevString, const std::vector<int> *parentKeyLengths) {
+template <typename Traits>
+std::string BasicBplustree<Traits>::printNode(Node *node, const int printLevel, std::string prevString, const std::vector<int> *parentKeyLengths) {
 	prevString += parentKeyLengths->empty() ? "" : "     ";
 	for (int i = 1; i <= printLevel; i++) {
 		prevString += "|";
@@ -340,35 +1261,640 @@ std::string Bplustree::printNode(Node *node, const int printLevel, std::string p
 	}
 
 	std::cout << prevString << " `---|";
-	for (int i = 0; i < node->getKeys()->size(); i++) {
-		std::cout << (*(node->getKeys()))[i] << "|";
+	if (node->isLeaf()) {
+		typename LeafNode::Keys *keys = static_cast<LeafNode *>(node)->getKeys();
+		for (int i = 0; i < keys->size(); i++) {
+			std::cout << (*keys)[i] << "|";
+		}
+	}
+	else {
+		typename InternalNode::Keys *keys = static_cast<InternalNode *>(node)->getKeys();
+		for (int i = 0; i < keys->size(); i++) {
+			std::cout << (*keys)[i] << "|";
+		}
 	}
 	std::cout << std::endl;
 	return prevString;
 }
 
-Bplustree::~Bplustree() {
-	destroy(root);
+template <typename Traits>
+BasicBplustree<Traits>::~BasicBplustree() {
+	delete frozen;
+	releaseNodes();
+	valueArena.clear();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::releaseNodes() {
+	/*
+	Ends the lifetime of every node and hands all slabs back at once.
+	Nodes of a fixed layout keep keys, children and value slots inline
+	and own nothing else, so no node is visited. Runtime order nodes
+	own vectors and are destroyed recursively. Value blocks are left
+	alone, so that spilled slots can outlive the nodes holding them.
+	*/
+	if (!Traits::fixedLayout) {
+		destroy(root);
+	}
+	root = nullptr;
+	rightmostLeaf = nullptr;
+	structureVersion++;
+	leafArena.clear();
+	internalArena.clear();
 }
 
-void Bplustree::destroy(Node *node) {
+template <typename Traits>
+void BasicBplustree<Traits>::destroy(Node *node) {
 	if(!node->isLeaf()) {
 		InternalNode *internal = static_cast<InternalNode *>(node);
 		for (Node *child : *(internal->getChildren())) {
 			destroy(child);
 		}
 	}
-	delete node;
+	node->~Node();
 }
 
-int Bplustree::getNumKeysStored() {
-	LeafNode *startLeaf = getLeftLeaf();
-	LeafNode *leaf = startLeaf->getNext();
-	int sum = 0;
-	while (startLeaf != leaf) {
-		sum += leaf->getKeys()->size();
+template <typename Traits>
+std::size_t BasicBplustree<Traits>::getNodeBytesReserved() const {
+	return leafArena.getBytesReserved() + internalArena.getBytesReserved();
+}
+
+template <typename Traits>
+std::size_t BasicBplustree<Traits>::getNodeBytesInUse() const {
+	return leafArena.getBytesInUse() + internalArena.getBytesInUse();
+}
+
+template <typename Traits>
+std::size_t BasicBplustree<Traits>::getValueBytesReserved() const {
+	return valueArena.getBytesReserved();
+}
+
+template <typename Traits>
+std::size_t BasicBplustree<Traits>::getValueBytesInUse() const {
+	return valueArena.getBytesInUse();
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::getNumKeysStored() const {
+	return numKeys.get();
+}
+
+template <typename Traits>
+TreeStats BasicBplustree<Traits>::getStats() const {
+	TreeStats stats;
+	stats.numKeys = numKeys.get();
+	stats.numValues = numValues.get();
+	stats.height = height.get();
+	stats.numLeaves = numLeaves.get();
+	stats.numInternalNodes = numInternalNodes.get();
+	stats.numSplits = numSplits.get();
+	stats.numMerges = numMerges.get();
+	stats.numRedistributions = numRedistributions.get();
+	stats.numDeferredRemoves = numDeferredRemoves.get();
+	stats.numAppends = numAppends.get();
+	return stats;
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::isBalanced() const {
+	/*
+	Returns true if every node but the root holds at least the minimum
+	number of entries and all leaves are at the same depth. Leaves left
+	underfull by relaxed removes, and the rightmost nodes split unevenly
+	by a run of appends, count as underflowing.
+	*/
+	if (frozen) {
+		return true;
+	}
+	int leafDepth = -1;
+	return isBalancedBelow(root, 0, &leafDepth);
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::isBalancedBelow(Node *node, const int depth, int *leafDepth) const {
+	if (node->isLeaf()) {
+		if (*leafDepth == -1) {
+			*leafDepth = depth;
+		}
+		return depth == *leafDepth && !node->hasUnderflow(order, root);
+	}
+	if (node->hasUnderflow(internalOrder, root)) {
+		return false;
+	}
+	for (Node *child : *(static_cast<InternalNode *>(node)->getChildren())) {
+		if (!isBalancedBelow(child, depth + 1, leafDepth)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<int> distributeEntries(const int total, const int perNode, const int minPerNode) {
+	/*
+	Splits total entries into node sizes of perNode entries each.
+	If the last node would underflow it is evened out with, or
+	merged into, its left neighbour.
+	*/
+	std::vector<int> sizes(total / perNode, perNode);
+	if (total % perNode) {
+		sizes.push_back(total % perNode);
+	}
+	if (sizes.size() > 1 && sizes.back() < minPerNode) {
+		int tot = sizes[sizes.size() - 2] + sizes.back();
+		sizes.pop_back();
+		if (tot / 2 >= minPerNode) {
+			sizes.back() = tot - tot / 2;
+			sizes.push_back(tot / 2);
+		}
+		else {
+			sizes.back() = tot;
+		}
+	}
+	return sizes;
+}
+
+template <typename Compare, typename Pair>
+static void parallelSortPairs(std::vector<Pair> &pairs) {
+	/*
+	Stable sort on key, so that values of duplicate keys keep their input
+	order as they would with repeated calls to insert. Chunks are sorted
+	concurrently and then merged pairwise, also concurrently.
+	*/
+	auto byKey = [](const Pair &a, const Pair &b) { return Compare()(a.first, b.first); };
+	const size_t numChunks = std::max(1u, std::thread::hardware_concurrency());
+	if (numChunks == 1 || pairs.size() < 65536) {
+		std::stable_sort(pairs.begin(), pairs.end(), byKey);
+		return;
+	}
+	std::vector<size_t> bounds;
+	for (size_t i = 0; i <= numChunks; i++) {
+		bounds.push_back(pairs.size() * i / numChunks);
+	}
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < numChunks; i++) {
+		threads.emplace_back([&, i] { std::stable_sort(pairs.begin() + bounds[i], pairs.begin() + bounds[i + 1], byKey); });
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	while (bounds.size() > 2) {
+		threads.clear();
+		std::vector<size_t> mergedBounds;
+		for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+			mergedBounds.push_back(bounds[i]);
+			threads.emplace_back([&, i] { std::inplace_merge(pairs.begin() + bounds[i], pairs.begin() + bounds[i + 1], pairs.begin() + bounds[i + 2], byKey); });
+		}
+		if (bounds.size() % 2 == 0) {
+			mergedBounds.push_back(bounds[bounds.size() - 2]);
+		}
+		mergedBounds.push_back(bounds.back());
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+		bounds = std::move(mergedBounds);
+	}
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::bulkLoad(const std::vector<Key> &keys, const std::vector<Value> &values, const double fillFactor) {
+	/*
+	Replaces the content of the tree by the key/value pairs given.
+	Input that is not sorted on key is sorted in parallel first.
+	*/
+	throwIfFrozen();
+	if (keys.size() != values.size()) {
+		throw std::string("keys.size() and values.size() must be equal\n");
+	}
+	if (fillFactor <= 0 || fillFactor > 1) {
+		throw std::string("fillFactor must be in the range (0, 1]\n");
+	}
+	std::vector<std::pair<Key, Value>> pairs;
+	pairs.reserve(keys.size());
+	for (int i = 0; i < keys.size(); i++) {
+		pairs.emplace_back(keys[i], values[i]);
+	}
+	if (!std::is_sorted(keys.begin(), keys.end(), Compare())) {
+		parallelSortPairs<Compare>(pairs);
+	}
+	int numUniqueKeys = pairs.empty() ? 0 : 1;
+	for (int i = 1; i < pairs.size(); i++) {
+		if (Compare()(pairs[i - 1].first, pairs[i].first)) {
+			numUniqueKeys++;
+		}
+	}
+	bulkLoad(pairs, numUniqueKeys, fillFactor);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::bulkLoad(const std::vector<std::pair<Key, Value>> &pairs, const int numUniqueKeys, const double fillFactor) {
+	/*
+	Builds the tree bottom-up from pairs sorted on key. Leaves are packed
+	left to right, then each level of internal nodes is built on top of
+	the previous one until a single root remains.
+	*/
+	releaseNodes();
+	valueArena.clear();
+	root = leafArena.newNode<LeafNode>();
+	numKeys.set(numUniqueKeys);
+	numValues.set(pairs.size());
+	height.set(1);
+	numLeaves.set(1);
+	numInternalNodes.set(0);
+	if (pairs.empty()) {
+		return;
+	}
+	const int minKeys = std::ceil(static_cast<double>(order) / 2) - 1;
+	const int keysPerNode = std::max(std::max(minKeys, 1), static_cast<int>(fillFactor * (order - 1)));
+
+	std::vector<Node *> level;
+	std::vector<Key> levelLowKeys;
+	std::vector<int> leafSizes = distributeEntries(numUniqueKeys, keysPerNode, minKeys);
+	int pairIndex = 0;
+	for (int leafSize : leafSizes) {
+		LeafNode *leaf = level.empty() ? static_cast<LeafNode *>(root) : leafArena.newNode<LeafNode>();
+		typename LeafNode::Keys *leafKeys = leaf->getKeys();
+		typename LeafNode::Values *leafValues = leaf->getValues();
+		leafKeys->reserve(leafSize);
+		leafValues->reserve(leafSize);
+		for (int i = 0; i < leafSize; i++) {
+			const Key key = pairs[pairIndex].first;
+			ValueSlot keyValues;
+			while (pairIndex < pairs.size() && !Compare()(key, pairs[pairIndex].first)) {
+				keyValues.push_back(pairs[pairIndex].second, valueArena);
+				pairIndex++;
+			}
+			leafKeys->push_back(key);
+			leafValues->push_back(keyValues);
+		}
+		level.push_back(leaf);
+		levelLowKeys.push_back(leafKeys->front());
+	}
+	buildLevels(level, levelLowKeys, fillFactor);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::buildLevels(std::vector<Node *> &level, std::vector<Key> &levelLowKeys, const double fillFactor) {
+	/*
+	Links the leaves given, in key order, into the circular leaf chain,
+	then builds each level of internal nodes on top of the previous one
+	until a single root remains. levelLowKeys holds the first key of
+	every leaf.
+	*/
+	for (int i = 0; i < level.size(); i++) {
+		LeafNode *leaf = static_cast<LeafNode *>(level[i]);
+		leaf->setNext(static_cast<LeafNode *>(level[(i + 1) % level.size()]));
+		leaf->setPrev(static_cast<LeafNode *>(level[(i + level.size() - 1) % level.size()]));
+	}
+	numLeaves.set(level.size());
+	numInternalNodes.set(0);
+	height.set(1);
+	const int minInternalKeys = std::ceil(static_cast<double>(internalOrder) / 2) - 1;
+	const int keysPerInternalNode = std::max(std::max(minInternalKeys, 1), static_cast<int>(fillFactor * (internalOrder - 1)));
+	while (level.size() > 1) {
+		std::vector<Node *> parentLevel;
+		std::vector<Key> parentLowKeys;
+		std::vector<int> internalSizes = distributeEntries(level.size(), keysPerInternalNode + 1, minInternalKeys + 1);
+		int childIndex = 0;
+		for (int internalSize : internalSizes) {
+			InternalNode *internal = internalArena.newNode<InternalNode>();
+			typename InternalNode::Keys *internalKeys = internal->getKeys();
+			typename InternalNode::Children *internalChildren = internal->getChildren();
+			typename InternalNode::Counts *internalCounts = internal->getCounts();
+			internalKeys->reserve(internalSize - 1);
+			internalChildren->reserve(internalSize);
+			internalCounts->reserve(internalSize);
+			parentLowKeys.push_back(levelLowKeys[childIndex]);
+			for (int i = 0; i < internalSize; i++) {
+				if (i > 0) {
+					internalKeys->push_back(levelLowKeys[childIndex]);
+				}
+				internalCounts->push_back(level[childIndex]->getNumSubtreeKeys());
+				internalChildren->push_back(level[childIndex++]);
+			}
+			parentLevel.push_back(internal);
+		}
+		numInternalNodes.add(parentLevel.size());
+		height.add(1);
+		level = std::move(parentLevel);
+		levelLowKeys = std::move(parentLowKeys);
+	}
+	root = level.front();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::setRelaxedRemoves(const bool relaxed) {
+	relaxedRemoves = relaxed;
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::needsCompaction(const double threshold) const {
+	/*
+	True once the removes left unbalanced since the last compaction
+	reach the given fraction of the number of leaves.
+	*/
+	return numDeferredRemoves.get() > 0 && numDeferredRemoves.get() >= threshold * numLeaves.get();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::compact(const double fillFactor) {
+	/*
+	Repacks the entries into leaves filled to fillFactor and rebuilds
+	the internal levels above them, merging the sparse leaves left by
+	relaxed removes in one pass.
+	*/
+	throwIfFrozen();
+	if (fillFactor <= 0 || fillFactor > 1) {
+		throw std::string("fillFactor must be in the range (0, 1]\n");
+	}
+	std::vector<Key> keys;
+	std::vector<ValueSlot> slots;
+	collectEntries(&keys, &slots);
+	loadEntries(keys, slots, fillFactor);
+	numDeferredRemoves.set(0);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::collectEntries(std::vector<Key> *keys, std::vector<ValueSlot> *slots) const {
+	keys->reserve(numKeys.get());
+	slots->reserve(numKeys.get());
+	LeafNode *firstLeaf = getLeftLeaf();
+	LeafNode *leaf = firstLeaf;
+	do {
+		keys->insert(keys->end(), leaf->getKeys()->begin(), leaf->getKeys()->end());
+		slots->insert(slots->end(), leaf->getValues()->begin(), leaf->getValues()->end());
 		leaf = leaf->getNext();
+	} while (leaf != firstLeaf);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::loadEntries(const std::vector<Key> &keys, const std::vector<ValueSlot> &slots, const double fillFactor) {
+	/*
+	Replaces the nodes by leaves filled to fillFactor with the entries
+	given in key order, and the internal levels above them. Value slots
+	are carried over as they are, so spilled value lists are not copied.
+	*/
+	releaseNodes();
+	root = leafArena.newNode<LeafNode>();
+	height.set(1);
+	numLeaves.set(1);
+	numInternalNodes.set(0);
+	if (keys.empty()) {
+		return;
+	}
+	const int minKeys = std::ceil(static_cast<double>(order) / 2) - 1;
+	const int keysPerNode = std::max(std::max(minKeys, 1), static_cast<int>(fillFactor * (order - 1)));
+
+	std::vector<Node *> level;
+	std::vector<Key> levelLowKeys;
+	std::vector<int> leafSizes = distributeEntries(keys.size(), keysPerNode, minKeys);
+	int entryIndex = 0;
+	for (int leafSize : leafSizes) {
+		LeafNode *leaf = level.empty() ? static_cast<LeafNode *>(root) : leafArena.newNode<LeafNode>();
+		typename LeafNode::Keys *leafKeys = leaf->getKeys();
+		typename LeafNode::Values *leafValues = leaf->getValues();
+		leafKeys->reserve(leafSize);
+		leafValues->reserve(leafSize);
+		for (int i = 0; i < leafSize; i++) {
+			leafKeys->push_back(keys[entryIndex]);
+			leafValues->push_back(slots[entryIndex]);
+			entryIndex++;
+		}
+		level.push_back(leaf);
+		levelLowKeys.push_back(leafKeys->front());
+	}
+	buildLevels(level, levelLowKeys, fillFactor);
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::freeze() {
+	/*
+	Moves the entries into a FrozenTree image and releases the nodes.
+	Reads are served from the image until thaw(), modifications throw.
+	Spilled value lists stay in the value arena, the image refers to
+	them through its value slots.
+	*/
+	if (frozen) {
+		return;
+	}
+	std::vector<Key> keys;
+	std::vector<ValueSlot> slots;
+	collectEntries(&keys, &slots);
+	frozen = new FrozenTree<Traits>(keys, slots, useHugePages);
+	releaseNodes();
+	root = leafArena.newNode<LeafNode>();
+	height.set(frozen->getNumLevels());
+	numLeaves.set(frozen->getNumBlocks());
+	numInternalNodes.set(frozen->getNumInternalNodes());
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::thaw(const double fillFactor) {
+	/*
+	Rebuilds mutable nodes filled to fillFactor from the frozen image.
+	*/
+	if (!frozen) {
+		return;
+	}
+	if (fillFactor <= 0 || fillFactor > 1) {
+		throw std::string("fillFactor must be in the range (0, 1]\n");
+	}
+	std::vector<Key> keys(frozen->getKeys(), frozen->getKeys() + frozen->size());
+	std::vector<ValueSlot> slots(frozen->getValues(), frozen->getValues() + frozen->size());
+	delete frozen;
+	frozen = nullptr;
+	loadEntries(keys, slots, fillFactor);
+}
+
+template <typename Traits>
+bool BasicBplustree<Traits>::isFrozen() const {
+	return frozen != nullptr;
+}
+
+template <typename Traits>
+std::size_t BasicBplustree<Traits>::getFrozenBytes() const {
+	return frozen ? frozen->getBytes() : 0;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::setSubtreeCounts(const bool enabled) {
+	/*
+	Structural changes always keep the counts of internal nodes in step
+	with their children, but only with subtree counts enabled do inserts
+	and removes of single keys update them. Enabling recounts the tree.
+	*/
+	if (enabled && !subtreeCounts && !frozen) {
+		recountSubtree(root);
 	}
-	sum += startLeaf->getKeys()->size();
-	return sum;
+	subtreeCounts = enabled;
 }
+
+template <typename Traits>
+int BasicBplustree<Traits>::recountSubtree(Node *node) {
+	if (node->isLeaf()) {
+		return node->getNumKeys();
+	}
+	InternalNode *internal = static_cast<InternalNode *>(node);
+	typename InternalNode::Counts *counts = internal->getCounts();
+	for (int i = 0; i < counts->size(); i++) {
+		(*counts)[i] = recountSubtree((*(internal->getChildren()))[i]);
+	}
+	return internal->getNumSubtreeKeys();
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::addToSubtreeCounts(const Key &key, const int delta) {
+	/*
+	Adds delta to the counts on the path to the leaf key belongs in.
+	This descends once more after the leaf was changed, which keeps the
+	append and hint fast paths of insert free of path bookkeeping.
+	*/
+	if (!subtreeCounts || delta == 0) {
+		return;
+	}
+	Node *node = root;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		const int index = internal->findChildIndex(key);
+		(*(internal->getCounts()))[index] += delta;
+		node = (*(internal->getChildren()))[index];
+	}
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::countKeysBelow(const Key &key, const bool inclusive) const {
+	/*
+	Returns the number of keys less than key, or not greater than key if
+	inclusive, adding up the counts of the children left of the path.
+	*/
+	const Compare compare;
+	if (frozen) {
+		const int index = frozen->lowerBound(key);
+		return index + (inclusive && index < frozen->size() && !compare(key, frozen->getKeys()[index]));
+	}
+	if (!subtreeCounts) {
+		throw std::string("subtree counts are disabled, enable them by setSubtreeCounts\n");
+	}
+	int count = 0;
+	Node *node = root;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		const int index = internal->findChildIndex(key);
+		typename InternalNode::Counts *counts = internal->getCounts();
+		for (int i = 0; i < index; i++) {
+			count += (*counts)[i];
+		}
+		node = (*(internal->getChildren()))[index];
+	}
+	typename LeafNode::Keys *keys = static_cast<LeafNode *>(node)->getKeys();
+	const int index = keyRankSearch<Key, Compare>(keys->data(), keys->size(), key);
+	return count + index + (inclusive && index < keys->size() && !compare(key, (*keys)[index]));
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::rank(const Key &key) const {
+	return countKeysBelow(key, false);
+}
+
+template <typename Traits>
+int BasicBplustree<Traits>::countRange(const Key &start, const Key &end) const {
+	if (Compare()(end, start)) {
+		return 0;
+	}
+	return countKeysBelow(end, true) - countKeysBelow(start, false);
+}
+
+template <typename Traits>
+typename BasicBplustree<Traits>::Aggregate BasicBplustree<Traits>::aggregate(const Key &start, const Key &end) const {
+	Aggregate result;
+	aggregateRange(start, end, true, &result);
+	return result;
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::aggregateRange(const Key &start, const Key &end, const bool endInclusive, Aggregate *result) const {
+	/*
+	Adds the count, sum, min and max of the values of the keys from start
+	up to end to result, folding the value slots of each leaf in place.
+	Only the leaves holding start and end are searched, the leaves in
+	between are folded whole.
+	*/
+	const Compare compare;
+	if (compare(end, start) || (!endInclusive && !compare(start, end))) {
+		return;
+	}
+	if (frozen) {
+		const int first = frozen->lowerBound(start);
+		int last = frozen->lowerBound(end);
+		if (endInclusive && last < frozen->size() && !compare(end, frozen->getKeys()[last])) {
+			last++;
+		}
+		if (first < last) {
+			ValueSlot::aggregate(frozen->getValues() + first, last - first, result);
+		}
+		return;
+	}
+	const LeafNode *rightmost = getLeftLeaf()->getPrev();
+	LeafNode *leaf = findLeaf(start);
+	typename LeafNode::Keys *keys = leaf->getKeys();
+	int first = keyRankSearch<Key, Compare>(keys->data(), keys->size(), start);
+	while (true) {
+		keys = leaf->getKeys();
+		int last = keys->size();
+		const bool endInLeaf = last > 0 && !compare((*keys)[last - 1], end);
+		if (endInLeaf) {
+			last = keyRankSearch<Key, Compare>(keys->data(), keys->size(), end);
+			if (endInclusive && last < keys->size() && !compare(end, (*keys)[last])) {
+				last++;
+			}
+		}
+		if (first < last) {
+			ValueSlot::aggregate(leaf->getValues()->data() + first, last - first, result);
+		}
+		if (endInLeaf || leaf == rightmost) {
+			return;
+		}
+		leaf = leaf->getNext();
+		first = 0;
+	}
+}
+
+template <typename Traits>
+const typename BasicBplustree<Traits>::ValueSlot *BasicBplustree<Traits>::select(const int rank, Key *key) const {
+	/*
+	Finds the key of the given rank, counting from 0, and returns its
+	values, or nullptr if rank is out of range.
+	*/
+	if (rank < 0 || rank >= numKeys.get()) {
+		return nullptr;
+	}
+	if (frozen) {
+		*key = frozen->getKeys()[rank];
+		return &frozen->getValues()[rank];
+	}
+	if (!subtreeCounts) {
+		throw std::string("subtree counts are disabled, enable them by setSubtreeCounts\n");
+	}
+	int remaining = rank;
+	Node *node = root;
+	while (!node->isLeaf()) {
+		InternalNode *internal = static_cast<InternalNode *>(node);
+		typename InternalNode::Counts *counts = internal->getCounts();
+		int index = 0;
+		while (remaining >= (*counts)[index]) {
+			remaining -= (*counts)[index++];
+		}
+		node = (*(internal->getChildren()))[index];
+	}
+	LeafNode *leaf = static_cast<LeafNode *>(node);
+	*key = (*(leaf->getKeys()))[remaining];
+	return &(*(leaf->getValues()))[remaining];
+}
+
+template <typename Traits>
+void BasicBplustree<Traits>::throwIfFrozen() const {
+	if (frozen) {
+		throw std::string("tree is frozen, thaw it before modifying it\n");
+	}
+}
+
+BPLUSTREE_INSTANTIATE(BasicBplustree)
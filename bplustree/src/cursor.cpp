@@ -0,0 +1,155 @@
+#include "cursor.hpp"
+#include "bplustree.hpp"
+#include "frozentree.hpp"
+#include "leafnode.hpp"
+#include "nodesearch.hpp"
+#include <algorithm>
+
+template <typename Traits>
+BasicCursor<Traits>::BasicCursor(const BasicBplustree<Traits> *tree) : tree(tree) {
+	seekToFirst();
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::enterLeaf(LeafNode *leaf, const int index) {
+	this->leaf = leaf;
+	this->keys = leaf->getKeys()->data();
+	this->values = leaf->getValues()->data();
+	this->numKeys = leaf->getKeys()->size();
+	this->index = index;
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::enterImage(const int index) {
+	this->leaf = nullptr;
+	this->keys = tree->frozen->getKeys();
+	this->values = tree->frozen->getValues();
+	this->numKeys = tree->frozen->size();
+	this->index = index;
+	if (index < 0 || index >= numKeys) {
+		invalidate();
+	}
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::invalidate() {
+	leaf = nullptr;
+	keys = nullptr;
+	numKeys = 0;
+	index = 0;
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::seek(const Key &key) {
+	/*
+	Positions the cursor at the first entry with a key not less than
+	key, or invalidates it if there is none.
+	*/
+	if (tree->frozen) {
+		enterImage(tree->frozen->lowerBound(key));
+		return;
+	}
+	LeafNode *found = tree->findLeaf(key);
+	const int numKeys = found->getKeys()->size();
+	const int index = keyRankSearch<Key, Compare>(found->getKeys()->data(), numKeys, key);
+	enterLeaf(found, index);
+	if (index == numKeys) {
+		nextLeaf();
+	}
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::seekToFirst() {
+	if (tree->frozen) {
+		enterImage(0);
+		return;
+	}
+	enterLeaf(tree->getLeftLeaf(), 0);
+	if (numKeys == 0) {
+		invalidate();
+	}
+}
+
+template <typename Traits>
+void BasicCursor<Traits>::seekToLast() {
+	if (tree->frozen) {
+		enterImage(tree->frozen->size() - 1);
+		return;
+	}
+	LeafNode *last = tree->getLeftLeaf()->getPrev();
+	enterLeaf(last, last->getKeys()->size() - 1);
+	if (numKeys == 0) {
+		invalidate();
+	}
+}
+
+template <typename Traits>
+bool BasicCursor<Traits>::nextLeaf() {
+	/*
+	The leaf chain is circular, so stepping from the last leaf lands on
+	the first one. That is detected by keys no longer increasing. The
+	image of a frozen tree is a single run, so its end is the end.
+	*/
+	if (!leaf) {
+		invalidate();
+		return false;
+	}
+	LeafNode *next = leaf->getNext();
+	if (next == leaf || next->getKeys()->empty() || !Compare()(keys[numKeys - 1], next->getKeys()->front())) {
+		invalidate();
+		return false;
+	}
+	enterLeaf(next, 0);
+	return true;
+}
+
+template <typename Traits>
+bool BasicCursor<Traits>::prevLeaf() {
+	if (!leaf) {
+		invalidate();
+		return false;
+	}
+	LeafNode *prev = leaf->getPrev();
+	if (prev == leaf || prev->getKeys()->empty() || !Compare()(prev->getKeys()->back(), keys[0])) {
+		invalidate();
+		return false;
+	}
+	enterLeaf(prev, prev->getKeys()->size() - 1);
+	return true;
+}
+
+template <typename Traits>
+int BasicCursor<Traits>::fetchUntil(Key *keys, const ValueSlot **values, const int maxEntries, const Key *end, const bool inclusive) {
+	/*
+	Copies up to maxEntries keys and value slot pointers with keys before
+	end (or up to and including end) into the given buffers, a leaf at a
+	time, and advances past them. A null end fetches to the last entry.
+	Returns the number of entries copied, which is 0 once the cursor is
+	exhausted or has passed end.
+	*/
+	int count = 0;
+	while (isValid() && count < maxEntries) {
+		const int available = std::min(numKeys - index, maxEntries - count);
+		const Key *first = this->keys + index;
+		const Key *last = first + available;
+		if (end) {
+			last = inclusive ? std::upper_bound(first, last, *end, Compare()) : std::lower_bound(first, last, *end, Compare());
+		}
+		const int fetched = last - first;
+		std::copy(first, last, keys + count);
+		for (int i = 0; i < fetched; i++) {
+			values[count + i] = &this->values[index + i];
+		}
+		count += fetched;
+		index += fetched;
+		if (fetched < available) {
+			break;
+		}
+		if (index == numKeys) {
+			nextLeaf();
+		}
+	}
+	return count;
+}
+
+BPLUSTREE_INSTANTIATE(BasicCursor)
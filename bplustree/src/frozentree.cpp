@@ -0,0 +1,126 @@
+#include "frozentree.hpp"
+#include "bplustreetraits.hpp"
+#include "nodesearch.hpp"
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+
+static const std::size_t CACHE_LINE_SIZE = 64;
+
+static std::size_t alignToCacheLine(const std::size_t offset) {
+	return (offset + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+template <typename Traits>
+FrozenTree<Traits>::FrozenTree(const std::vector<Key> &keys, const std::vector<ValueSlot> &values, const bool useHugePages) :
+	numEntries(keys.size()),
+	image(nullptr),
+	bytes(0),
+	keys(nullptr),
+	values(nullptr) {
+	/*
+	Builds the separator levels bottom-up from the largest key of every
+	block. The last node of a level may have fewer children; its unused
+	separators repeat the largest key, so that searches never rank past
+	its last child except for keys above all keys, which are clamped.
+	*/
+	if (numEntries == 0) {
+		return;
+	}
+	std::vector<std::vector<Key>> levelKeys;
+	std::vector<Key> childMax;
+	for (int block = 0; block < getNumBlocks(); block++) {
+		childMax.push_back(keys[std::min(numEntries, (block + 1) * keysPerNode) - 1]);
+	}
+	while (childMax.size() > 1) {
+		const int numChildren = childMax.size();
+		const int numNodes = (numChildren + fanout - 1) / fanout;
+		std::vector<Key> separators(static_cast<std::size_t>(numNodes) * keysPerNode, childMax.back());
+		std::vector<Key> nodeMax;
+		for (int node = 0; node < numNodes; node++) {
+			const int firstChild = node * fanout;
+			for (int i = 0; i < keysPerNode && firstChild + i < numChildren; i++) {
+				separators[node * keysPerNode + i] = childMax[firstChild + i];
+			}
+			nodeMax.push_back(childMax[std::min(numChildren, firstChild + fanout) - 1]);
+		}
+		levelKeys.push_back(std::move(separators));
+		levelChildren.push_back(numChildren);
+		childMax = std::move(nodeMax);
+	}
+	std::reverse(levelKeys.begin(), levelKeys.end());
+	std::reverse(levelChildren.begin(), levelChildren.end());
+
+	std::vector<std::size_t> levelOffsets;
+	for (const std::vector<Key> &separators : levelKeys) {
+		levelOffsets.push_back(bytes);
+		bytes = alignToCacheLine(bytes + separators.size() * sizeof(Key));
+	}
+	const std::size_t keysOffset = bytes;
+	bytes = alignToCacheLine(bytes + numEntries * sizeof(Key));
+	const std::size_t valuesOffset = bytes;
+	bytes += numEntries * sizeof(ValueSlot);
+	image = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (image == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+#ifdef MADV_HUGEPAGE
+	if (useHugePages) {
+		madvise(image, bytes, MADV_HUGEPAGE);
+	}
+#endif
+	char *base = static_cast<char *>(image);
+	for (int level = 0; level < levelKeys.size(); level++) {
+		Key *separators = reinterpret_cast<Key *>(base + levelOffsets[level]);
+		std::uninitialized_copy(levelKeys[level].begin(), levelKeys[level].end(), separators);
+		levels.push_back(separators);
+	}
+	this->keys = std::uninitialized_copy(keys.begin(), keys.end(), reinterpret_cast<Key *>(base + keysOffset)) - numEntries;
+	this->values = std::uninitialized_copy(values.begin(), values.end(), reinterpret_cast<ValueSlot *>(base + valuesOffset)) - numEntries;
+}
+
+template <typename Traits>
+FrozenTree<Traits>::~FrozenTree() {
+	if (image) {
+		munmap(image, bytes);
+	}
+}
+
+template <typename Traits>
+int FrozenTree<Traits>::lowerBound(const Key &key) const {
+	/*
+	Returns the index of the first entry with a key not less than key,
+	or size() if there is none. One rank search per level picks the
+	child, whose node is found by arithmetic rather than a pointer load.
+	*/
+	if (numEntries == 0) {
+		return 0;
+	}
+	int child = 0;
+	for (int level = 0; level < levels.size(); level++) {
+		const Key *node = levels[level] + static_cast<std::size_t>(child) * keysPerNode;
+		child = std::min(child * fanout + keyRankSearch<Key, Compare>(node, keysPerNode, key), levelChildren[level] - 1);
+	}
+	const int first = child * keysPerNode;
+	return first + keyRankSearch<Key, Compare>(keys + first, std::min(keysPerNode, numEntries - first), key);
+}
+
+template <typename Traits>
+const typename FrozenTree<Traits>::ValueSlot *FrozenTree<Traits>::search(const Key &key) const {
+	const int index = lowerBound(key);
+	if (index == numEntries || Compare()(key, keys[index])) {
+		return nullptr;
+	}
+	return &values[index];
+}
+
+template <typename Traits>
+long long FrozenTree<Traits>::getNumInternalNodes() const {
+	long long numNodes = 0;
+	for (int level = 0; level < levels.size(); level++) {
+		numNodes += (levelChildren[level] + fanout - 1) / fanout;
+	}
+	return numNodes;
+}
+
+BPLUSTREE_INSTANTIATE(FrozenTree)
@@ -1,47 +1,100 @@
 #include "internalnode.hpp"
 #include "leafnode.hpp"
+#include "nodesearch.hpp"
+#include <algorithm>
 #include <cmath>
 
-InternalNode::InternalNode() {
-	leaf = false;
+template <typename Traits>
+InternalNode<Traits>::InternalNode() {
+	this->leaf = false;
 }
 
-std::vector<Node *> *InternalNode::getChildren() {
+template <typename Traits>
+typename InternalNode<Traits>::Keys *InternalNode<Traits>::getKeys() {
+	return &keys;
+}
+
+template <typename Traits>
+int InternalNode<Traits>::getNumKeys() const {
+	return keys.size();
+}
+
+template <typename Traits>
+typename InternalNode<Traits>::Children *InternalNode<Traits>::getChildren() {
 	return &children;
 };
 
-void InternalNode::insert(const int key, Node *right) {
-	std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
-	keys.insert(low, key);
-	low = std::lower_bound(keys.begin(), keys.end(), key);
-	children.insert(children.begin() + (low - keys.begin() + 1), right);
+template <typename Traits>
+typename InternalNode<Traits>::Counts *InternalNode<Traits>::getCounts() {
+	return &counts;
+}
+
+template <typename Traits>
+int InternalNode<Traits>::getNumSubtreeKeys() const {
+	int numKeys = 0;
+	for (int count : counts) {
+		numKeys += count;
+	}
+	return numKeys;
+}
+
+template <typename Traits>
+int InternalNode<Traits>::findChildIndex(const Key &key) const {
+	int index = keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
+	// Keys equal to a separator belong to its right child
+	if (index < keys.size() && !Compare()(key, keys[index])) {
+		return index + 1;
+	}
+	return index;
+}
+
+template <typename Traits>
+void InternalNode<Traits>::insert(const Key &key, Node *right) {
+	int index = keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
+	keys.insert(keys.begin() + index, key);
+	children.insert(children.begin() + index + 1, right);
+	// right was split off the child before it
+	counts[index] = children[index]->getNumSubtreeKeys();
+	counts.insert(counts.begin() + index + 1, right->getNumSubtreeKeys());
 }
 
-void InternalNode::insert(const int key, Node *left, Node *right) {
+template <typename Traits>
+void InternalNode<Traits>::insert(const Key &key, Node *left, Node *right) {
 	keys.push_back(key);
 	children.push_back(left);
 	children.push_back(right);
+	counts.push_back(left->getNumSubtreeKeys());
+	counts.push_back(right->getNumSubtreeKeys());
 }
 
-InternalNode *InternalNode::split(int *keyToParent) {
-	int length = keys.size();
-	InternalNode *right = new InternalNode();
-	*keyToParent = keys[length / 2];
+template <typename Traits>
+InternalNode<Traits> *InternalNode<Traits>::split(Key *keyToParent, NodeArena &arena, const int splitIndex) {
+	/*
+	Keeps the keys before splitIndex, moves the key at splitIndex up to
+	the parent and the keys after it to the new right node.
+	*/
+	InternalNode *right = arena.newNode<InternalNode>();
+	*keyToParent = keys[splitIndex];
+
+	right->keys.assign(keys.begin() + splitIndex + 1, keys.end());
+	keys.erase(keys.begin() + splitIndex, keys.end());
 
-	right->keys.assign(keys.begin() + length / 2 + 1, keys.end());
-	keys.erase(keys.begin() + length / 2, keys.end());
+	right->children.assign(children.begin() + splitIndex + 1, children.end());
+	children.erase(children.begin() + splitIndex + 1, children.end());
 
-	right->children.assign(children.begin() + length / 2 + 1, children.end());
-	children.erase(children.begin() + length / 2 + 1, children.end());
+	right->counts.assign(counts.begin() + splitIndex + 1, counts.end());
+	counts.erase(counts.begin() + splitIndex + 1, counts.end());
 
 	return right;
 }
 
-bool InternalNode::remove(const int key) {
-	std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
+template <typename Traits>
+bool InternalNode<Traits>::remove(const Key &key) {
+	typename Keys::iterator low = keys.begin() + keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
 	if (low - keys.begin() < keys.size()) {
-		if (key == keys[low - keys.begin()]) {
+		if (!Compare()(key, keys[low - keys.begin()])) {
 			children.erase(children.begin() + (low + 1 - keys.begin()));
+			counts.erase(counts.begin() + (low + 1 - keys.begin()));
 			keys.erase(low);
 			return true;
 		}
@@ -49,55 +102,57 @@ bool InternalNode::remove(const int key) {
 	return false;
 }
 
-void InternalNode::removeByKeyIndex(const int keyIndex) {
+template <typename Traits>
+void InternalNode<Traits>::removeByKeyIndex(const int keyIndex) {
+	// The child after the key was merged into the one before it
+	counts[keyIndex] += counts[keyIndex + 1];
+	counts.erase(counts.begin() + keyIndex + 1);
 	children.erase(children.begin() + keyIndex + 1);
 	keys.erase(keys.begin() + keyIndex);
 }
 
-std::tuple<Node *, bool, int, int> InternalNode::getSibling(const Node *node, const int order, const Node *root) const {
+template <typename Traits>
+std::tuple<Node<Traits> *, bool, typename InternalNode<Traits>::Key, int> InternalNode<Traits>::getSibling(const int index, const int order, const Node *root) const {
 	/*
-	Returns a sibling that should be used for redistribution or merge during remove.
-	If possible a sibling that allows for redistribution is returned.
+	Returns a sibling of the child at index that should be used for
+	redistribution or merge during remove. If possible a sibling that
+	allows for redistribution is returned.
 
 	:return: sibling, siblingIsOnRHS, splittingKey, splittingKeyIndex
 	*/
-	std::vector<Node *>::const_iterator it;
-	it = std::find(children.begin(), children.end(), node);
-	if (it != children.end()) {
-		// node found in children vector
-		int index = it - children.begin();
-		if ((index - 1 >= 0) && (index + 1 <= children.size() - 1)) {
-			// right and left sibling exist
-			if (children[index - 1]->hasExtraEntries(order, root)) {
-				// redistribution using left is possible
-				return std::make_tuple(children[index - 1], false, keys[index - 1], index - 1);
-			}
-			else {
-				// redistribute or merge using right
-				return std::make_tuple(children[index + 1], true, keys[index], index);
-			}
-		}
-		else if (index + 1 <= children.size() - 1) {
-			// only right sibling exist
-			return std::make_tuple(children[index + 1], true, keys[index], index);
+	if ((index - 1 >= 0) && (index + 1 <= children.size() - 1)) {
+		// right and left sibling exist
+		if (children[index - 1]->hasExtraEntries(order, root)) {
+			// redistribution using left is possible
+			return std::make_tuple(children[index - 1], false, keys[index - 1], index - 1);
 		}
 		else {
-			// only left sibling exist
-			return std::make_tuple(children[index - 1], false, keys[index - 1], index - 1);
+			// redistribute or merge using right
+			return std::make_tuple(children[index + 1], true, keys[index], index);
 		}
 	}
-	throw "node not found in children";
+	else if (index + 1 <= children.size() - 1) {
+		// only right sibling exist
+		return std::make_tuple(children[index + 1], true, keys[index], index);
+	}
+	else {
+		// only left sibling exist
+		return std::make_tuple(children[index - 1], false, keys[index - 1], index - 1);
+	}
 }
 
-void InternalNode::redistribute(InternalNode *node, InternalNode *sibling, const bool siblingIsOnRHS, const int splittingKey, const int splittingKeyIndex) {
+template <typename Traits>
+void InternalNode<Traits>::redistribute(InternalNode *node, InternalNode *sibling, const bool siblingIsOnRHS, const Key &splittingKey, const int splittingKeyIndex) {
 	/*
 	Redistributes keys and children between two internal nodes that are siblings.
 	Assumes that this internal node is their parent.
 	*/
-	std::vector<int> *nodeKeys = node->getKeys();
-	std::vector<int> *siblingKeys = sibling->getKeys();
-	std::vector<Node *> *nodeChildren = node->getChildren();
-	std::vector<Node *> *siblingChildren = sibling->getChildren();
+	Keys *nodeKeys = node->getKeys();
+	Keys *siblingKeys = sibling->getKeys();
+	Children *nodeChildren = node->getChildren();
+	Children *siblingChildren = sibling->getChildren();
+	Counts *nodeCounts = node->getCounts();
+	Counts *siblingCounts = sibling->getCounts();
 	int totKeys = nodeKeys->size() + siblingKeys->size();
 	int nodeNumKeysToReceive = std::floor(static_cast<double>(totKeys) / 2) - nodeKeys->size();
 	// push from right to left through parent
@@ -108,6 +163,8 @@ void InternalNode::redistribute(InternalNode *node, InternalNode *sibling, const
 		siblingKeys->erase(siblingKeys->begin(), siblingKeys->begin() + nodeNumKeysToReceive);
 		nodeChildren->insert(nodeChildren->end(), siblingChildren->begin(), siblingChildren->begin() + nodeNumKeysToReceive);
 		siblingChildren->erase(siblingChildren->begin(), siblingChildren->begin() + nodeNumKeysToReceive);
+		nodeCounts->insert(nodeCounts->end(), siblingCounts->begin(), siblingCounts->begin() + nodeNumKeysToReceive);
+		siblingCounts->erase(siblingCounts->begin(), siblingCounts->begin() + nodeNumKeysToReceive);
 	}
 	// push from left to right through parent
 	else {
@@ -117,18 +174,23 @@ void InternalNode::redistribute(InternalNode *node, InternalNode *sibling, const
 		siblingKeys->erase(siblingKeys->end() - nodeNumKeysToReceive, siblingKeys->end());
 		nodeChildren->insert(nodeChildren->begin(), siblingChildren->end() - nodeNumKeysToReceive, siblingChildren->end());
 		siblingChildren->erase(siblingChildren->end() - nodeNumKeysToReceive, siblingChildren->end());
+		nodeCounts->insert(nodeCounts->begin(), siblingCounts->end() - nodeNumKeysToReceive, siblingCounts->end());
+		siblingCounts->erase(siblingCounts->end() - nodeNumKeysToReceive, siblingCounts->end());
 	}
+	counts[splittingKeyIndex] = children[splittingKeyIndex]->getNumSubtreeKeys();
+	counts[splittingKeyIndex + 1] = children[splittingKeyIndex + 1]->getNumSubtreeKeys();
 }
 
-void InternalNode::redistribute(LeafNode *node, LeafNode *sibling, const bool siblingIsOnRHS, const int splittingKey, const int splittingKeyIndex) {
+template <typename Traits>
+void InternalNode<Traits>::redistribute(LeafNode *node, LeafNode *sibling, const bool siblingIsOnRHS, const Key &splittingKey, const int splittingKeyIndex) {
 	/*
 	Redistributes keys and values between two leaf nodes that are siblings.
 	Assumes that this internal node is their parent.
 	*/
-	std::vector<int> *nodeKeys = node->getKeys();
-	std::vector<int> *siblingKeys = sibling->getKeys();
-	std::vector<std::vector<int> *> *nodeValues = node->getValues();
-	std::vector<std::vector<int> *> *siblingValues = sibling->getValues();
+	typename LeafNode::Keys *nodeKeys = node->getKeys();
+	typename LeafNode::Keys *siblingKeys = sibling->getKeys();
+	typename LeafNode::Values *nodeValues = node->getValues();
+	typename LeafNode::Values *siblingValues = sibling->getValues();
 	int totKeys = nodeKeys->size() + siblingKeys->size();
 	int nodeNumKeysToReceive = std::floor(static_cast<double>(totKeys) / 2) - nodeKeys->size();
 	// push from right to left through parent
@@ -147,19 +209,25 @@ void InternalNode::redistribute(LeafNode *node, LeafNode *sibling, const bool si
 		nodeValues->insert(nodeValues->begin(), siblingValues->end() - nodeNumKeysToReceive, siblingValues->end());
 		siblingValues->erase(siblingValues->end() - nodeNumKeysToReceive, siblingValues->end());
 	}
+	counts[splittingKeyIndex] = children[splittingKeyIndex]->getNumSubtreeKeys();
+	counts[splittingKeyIndex + 1] = children[splittingKeyIndex + 1]->getNumSubtreeKeys();
 }
 
-void InternalNode::merge(InternalNode *sibling, const int splittingKey) {
+template <typename Traits>
+void InternalNode<Traits>::merge(InternalNode *sibling, const Key &splittingKey, NodeArena &arena) {
 	/*
 	Merge all entries of sibling (assumed sibling is on rhs) into
-	this internal node, and then delete the now unneeded sibling.
+	this internal node, and then return the now unneeded sibling to arena.
 	As called in remove of Bplustree clean up of invalid parent entry
 	is dealt with by the respectiv parent when its recursive call returns.
 	*/
 	keys.push_back(splittingKey);
-	std::vector<int> *siblingKeys = sibling->getKeys();
-	std::vector<Node *> *siblingChildren = sibling->getChildren();
+	Keys *siblingKeys = sibling->getKeys();
+	Children *siblingChildren = sibling->getChildren();
 	keys.insert(keys.end(), siblingKeys->begin(), siblingKeys->end());
 	children.insert(children.end(), siblingChildren->begin(), siblingChildren->end());
-	delete sibling;
+	counts.insert(counts.end(), sibling->getCounts()->begin(), sibling->getCounts()->end());
+	arena.deleteNode(sibling);
 }
+
+BPLUSTREE_INSTANTIATE(InternalNode)
@@ -1,38 +1,65 @@
 #include "leafnode.hpp"
+#include "nodesearch.hpp"
 #include <iostream>
 
-LeafNode::LeafNode() : next(this), prev(this) {
-	leaf = true;
+template <typename Traits>
+LeafNode<Traits>::LeafNode() : next(this), prev(this) {
+	this->leaf = true;
 };
 
-LeafNode::~LeafNode() {
-	for (std::vector<int> *value : values) {
-		delete value;
-	}
-}
-
-LeafNode *LeafNode::getNext() const {
+template <typename Traits>
+LeafNode<Traits> *LeafNode<Traits>::getNext() const {
 	return next;
 }
 
-LeafNode *LeafNode::getPrev() const {
+template <typename Traits>
+LeafNode<Traits> *LeafNode<Traits>::getPrev() const {
 	return prev;
 }
 
-std::vector<int> *LeafNode::getValues(const int key) {
-	std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
+template <typename Traits>
+void LeafNode<Traits>::setNext(LeafNode *next) {
+	this->next = next;
+}
+
+template <typename Traits>
+void LeafNode<Traits>::setPrev(LeafNode *prev) {
+	this->prev = prev;
+}
+
+template <typename Traits>
+typename LeafNode<Traits>::Keys *LeafNode<Traits>::getKeys() {
+	return &keys;
+}
+
+template <typename Traits>
+int LeafNode<Traits>::getNumKeys() const {
+	return keys.size();
+}
+
+template <typename Traits>
+int LeafNode<Traits>::getNumSubtreeKeys() const {
+	return keys.size();
+}
+
+template <typename Traits>
+const typename LeafNode<Traits>::ValueSlot *LeafNode<Traits>::getValues(const Key &key) const {
+	typename Keys::const_iterator low = keys.begin() + keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
 	if (low - keys.begin() < keys.size()) {
-		if (key == keys[low - keys.begin()]) {
-			return values[low - keys.begin()];
+		if (!Compare()(key, keys[low - keys.begin()])) {
+			return &values[low - keys.begin()];
 		}
 	}
 	return nullptr;
 }
 
-bool LeafNode::remove(const int key) {
-	std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
+template <typename Traits>
+bool LeafNode<Traits>::remove(const Key &key, ValueArena &arena, int *numOldValues) {
+	typename Keys::iterator low = keys.begin() + keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
 	if (low - keys.begin() < keys.size()) {
-		if (key == keys[low - keys.begin()]) {
+		if (!Compare()(key, keys[low - keys.begin()])) {
+			*numOldValues = values[low - keys.begin()].size();
+			values[low - keys.begin()].release(arena);
 			values.erase(values.begin() + (low - keys.begin()));
 			keys.erase(low);
 			return true;
@@ -41,44 +68,68 @@ bool LeafNode::remove(const int key) {
 	return false;
 }
 
-void LeafNode::insert(const int key, const int value) {
-	std::vector<int> *someValues = getValues(key);
-	if (someValues) {
-		someValues->push_back(value);
+template <typename Traits>
+int LeafNode<Traits>::removeRange(const Key &start, const Key &end, ValueArena &arena, int *numOldValues) {
+	/*
+	Removes the entries with keys from start up to end, assumed not to
+	be less than start, and returns how many there were.
+	*/
+	const int first = keyRankSearch<Key, Compare>(keys.data(), keys.size(), start);
+	int last = keyRankSearch<Key, Compare>(keys.data(), keys.size(), end);
+	if (last < keys.size() && !Compare()(end, keys[last])) {
+		last++;
+	}
+	*numOldValues = 0;
+	for (int i = first; i < last; i++) {
+		*numOldValues += values[i].size();
+		values[i].release(arena);
+	}
+	keys.erase(keys.begin() + first, keys.begin() + last);
+	values.erase(values.begin() + first, values.begin() + last);
+	return last - first;
+}
+
+template <typename Traits>
+void LeafNode<Traits>::insert(const Key &key, const Value value, ValueArena &arena) {
+	int index = keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
+	if (index < keys.size() && !Compare()(key, keys[index])) {
+		values[index].push_back(value, arena);
 	}
 	else {
-		std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
-		int index = low - keys.begin();
-		keys.insert(low, key);
-		someValues = new std::vector<int>();
-		someValues->push_back(value);
-		values.insert(values.begin() + index, std::move(someValues));
+		keys.insert(keys.begin() + index, key);
+		ValueSlot someValues;
+		someValues.push_back(value, arena);
+		values.insert(values.begin() + index, someValues);
 	}
 }
 
-void LeafNode::insert(const int key, const std::vector<int> &values) {
-	std::vector<int> *someValues = getValues(key);
-	if (someValues) {
-		someValues->insert(someValues->end(), values.begin(), values.end());
+template <typename Traits>
+void LeafNode<Traits>::insert(const Key &key, const std::vector<Value> &values, ValueArena &arena) {
+	int index = keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
+	if (index < keys.size() && !Compare()(key, keys[index])) {
+		this->values[index].append(values.data(), values.data() + values.size(), arena);
 	}
 	else {
-		std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
-		int index = low - keys.begin();
-		keys.insert(low, key);
-		someValues = new std::vector<int>(values);
-		this->values.insert(this->values.begin() + index, std::move(someValues));
+		keys.insert(keys.begin() + index, key);
+		ValueSlot someValues;
+		someValues.assign(values.data(), values.data() + values.size(), arena);
+		this->values.insert(this->values.begin() + index, someValues);
 	}
 }
 
-LeafNode *LeafNode::split(int *keyToParent) {
-	int length = keys.size();
-	LeafNode *right = new LeafNode();
-	*keyToParent = keys[length / 2];
+template <typename Traits>
+LeafNode<Traits> *LeafNode<Traits>::split(Key *keyToParent, NodeArena &arena, const int splitIndex) {
+	/*
+	Keeps the entries before splitIndex and moves the rest to the new
+	right leaf, whose first key becomes the separator.
+	*/
+	LeafNode *right = arena.newNode<LeafNode>();
+	*keyToParent = keys[splitIndex];
 
-	right->keys.assign(keys.begin() + length / 2, keys.end());
-	keys.erase(keys.begin() + length / 2, keys.end());
-	right->values.assign(values.begin() + length / 2, values.end());
-	values.erase(values.begin() + length / 2, values.end());
+	right->keys.assign(keys.begin() + splitIndex, keys.end());
+	keys.erase(keys.begin() + splitIndex, keys.end());
+	right->values.assign(values.begin() + splitIndex, values.end());
+	values.erase(values.begin() + splitIndex, values.end());
 
 	right->prev = this;
 	right->next = this->next;
@@ -88,16 +139,17 @@ LeafNode *LeafNode::split(int *keyToParent) {
 	return right;
 }
 
-LeafNode *LeafNode::scan(const int start, const int end, const LeafNode *startLeaf, std::map<int, std::vector<int>> &result) const {
+template <typename Traits>
+LeafNode<Traits> *LeafNode<Traits>::scan(const Key &start, const Key &end, const LeafNode *startLeaf, std::map<Key, std::vector<Value>, Compare> &result) const {
 	int index = 0;
 	if (this == startLeaf) {
-		std::vector<int>::const_iterator low = std::lower_bound(keys.begin(), keys.end(), start);
+		typename Keys::const_iterator low = keys.begin() + keyRankSearch<Key, Compare>(keys.data(), keys.size(), start);
 		index = low - keys.begin();
 	}
 	if (index < keys.size()) {
 		for (int i = index; i < keys.size(); i++) {
-			if (keys[i] <= end) {
-				result[keys[i]] = *values[i];
+			if (!Compare()(end, keys[i])) {
+				result[keys[i]].assign(values[i].begin(), values[i].end());
 			}
 			else {
 				return nullptr;
@@ -107,41 +159,47 @@ LeafNode *LeafNode::scan(const int start, const int end, const LeafNode *startLe
 	return next != startLeaf ? next : nullptr;
 }
 
-LeafNode *LeafNode::scanFull(std::map<int, std::vector<int>> &result) const {
-	for (std::vector<int>::const_iterator it = keys.begin(); it != keys.end(); it++) {
-		result[*it] = *values[it - keys.begin()];
+template <typename Traits>
+LeafNode<Traits> *LeafNode<Traits>::scanFull(std::map<Key, std::vector<Value>, Compare> &result) const {
+	for (typename Keys::const_iterator it = keys.begin(); it != keys.end(); it++) {
+		result[*it].assign(values[it - keys.begin()].begin(), values[it - keys.begin()].end());
 	}
 	return next;
 }
 
-bool LeafNode::update(const int key, const std::vector<int> &values) {
-	std::vector<int>::iterator low = std::lower_bound(keys.begin(), keys.end(), key);
+template <typename Traits>
+bool LeafNode<Traits>::update(const Key &key, const std::vector<Value> &values, ValueArena &arena, int *numOldValues) {
+	typename Keys::iterator low = keys.begin() + keyRankSearch<Key, Compare>(keys.data(), keys.size(), key);
 	if (low - keys.begin() < keys.size()) {
-		if (key == keys[low - keys.begin()]) {
-			this->values[low - keys.begin()] = new std::vector<int>(values);
+		if (!Compare()(key, keys[low - keys.begin()])) {
+			*numOldValues = this->values[low - keys.begin()].size();
+			this->values[low - keys.begin()].assign(values.data(), values.data() + values.size(), arena);
 			return true;
 		}
 	}
 	return false;
 }
 
-std::vector<std::vector<int> *> *LeafNode::getValues() {
+template <typename Traits>
+typename LeafNode<Traits>::Values *LeafNode<Traits>::getValues() {
 	return &values;
 }
 
-void LeafNode::merge(LeafNode *sibling) {
+template <typename Traits>
+void LeafNode<Traits>::merge(LeafNode *sibling, NodeArena &arena) {
 	/*
 	Merge all entries of sibling (assumed sibling is on rhs) into
-	this leaf, and then delete the now unneeded sibling. As called
+	this leaf, and then return the now unneeded sibling to arena. As called
 	in remove of Bplustree clean up of invalid parent entry is dealt
 	with by the respectiv parent when its recursive call returns.
 	*/
-	std::vector<int> *siblingKeys = sibling->getKeys();
-	std::vector<std::vector<int> *> *siblingValues = sibling->getValues();
+	Keys *siblingKeys = sibling->getKeys();
+	Values *siblingValues = sibling->getValues();
 	keys.insert(keys.end(), siblingKeys->begin(), siblingKeys->end());
 	values.insert(values.end(), siblingValues->begin(), siblingValues->end());
-	siblingValues->clear();
 	this->next = sibling->next;
 	(sibling->next)->prev = this;
-	delete sibling;
+	arena.deleteNode(sibling);
 }
+
+BPLUSTREE_INSTANTIATE(LeafNode)
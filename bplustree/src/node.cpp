@@ -1,40 +1,42 @@
 #include "node.hpp"
 #include <cmath>
 
-Node::~Node() {};
+template <typename Traits>
+Node<Traits>::~Node() {};
 
-std::vector<int> *Node::getKeys() {
-	return &keys;
-}
-
-bool Node::isLeaf() const {
+template <typename Traits>
+bool Node<Traits>::isLeaf() const {
 	return leaf;
 }
 
-bool Node::hasExtraEntries(const int order, const Node *root) const {
+template <typename Traits>
+bool Node<Traits>::hasExtraEntries(const int order, const Node *root) const {
 	if (!(this == root)) {
-		return keys.size() > std::ceil(static_cast<double>(order) / 2) - 1;
+		return getNumKeys() > std::ceil(static_cast<double>(order) / 2) - 1;
 	}
 	else {
 		if (leaf) {
 			return true;
 		}
 		else {
-			return keys.size() > 1;
+			return getNumKeys() > 1;
 		}
 	}
 }
 
-bool Node::hasUnderflow(const int order, const Node *root) const {
+template <typename Traits>
+bool Node<Traits>::hasUnderflow(const int order, const Node *root) const {
 	if (!(this == root)) {
-		return (keys.size() < std::ceil(static_cast<double>(order) / 2) - 1);
+		return (getNumKeys() < std::ceil(static_cast<double>(order) / 2) - 1);
 	}
 	else {
 		if (leaf) {
 			return false;
 		}
 		else {
-			return keys.size() < 1;
+			return getNumKeys() < 1;
 		}
 	}
 }
+
+BPLUSTREE_INSTANTIATE(Node)
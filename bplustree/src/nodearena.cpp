@@ -0,0 +1,112 @@
+#include "nodearena.hpp"
+#include <algorithm>
+#include <sys/mman.h>
+
+static const std::size_t CACHE_LINE_SIZE = 64;
+static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+NodeArena::NodeArena(const std::size_t objectSize, const bool useHugePages) :
+	slotSize((objectSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE),
+	slabSize(std::max(HUGE_PAGE_SIZE, (objectSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE)),
+	useHugePages(useHugePages),
+	slabs(std::make_shared<Slabs>(slabSize)),
+	bump(nullptr),
+	bumpEnd(nullptr),
+	freeList(nullptr),
+	slotsInUse(0) {}
+
+NodeArena::~NodeArena() {
+	clear();
+}
+
+NodeArena::Slabs::~Slabs() {
+	for (void *slab : slabs) {
+		munmap(slab, slabSize);
+	}
+}
+
+void NodeArena::addSlab() {
+	void *slab = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (useHugePages) {
+		slab = mmap(nullptr, slabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (slab == MAP_FAILED) {
+		// No reserved huge pages, fall back to regular pages and ask for transparent huge pages
+		slab = mmap(nullptr, slabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (slab == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+#ifdef MADV_HUGEPAGE
+		if (useHugePages) {
+			madvise(slab, slabSize, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	slabs->slabs.push_back(slab);
+	bump = static_cast<char *>(slab);
+	bumpEnd = bump + slabSize / slotSize * slotSize;
+}
+
+void *NodeArena::allocate() {
+	slotsInUse++;
+	if (freeList) {
+		FreeSlot *slot = freeList;
+		freeList = slot->next;
+		return slot;
+	}
+	if (bump == bumpEnd) {
+		addSlab();
+	}
+	void *slot = bump;
+	bump += slotSize;
+	return slot;
+}
+
+void NodeArena::deallocate(void *slot) {
+	FreeSlot *freeSlot = static_cast<FreeSlot *>(slot);
+	freeSlot->next = freeList;
+	freeList = freeSlot;
+	slotsInUse--;
+}
+
+void NodeArena::clear() {
+	/*
+	Releases every slab at once. Objects still living in the arena
+	must have been destroyed, or own nothing, before calling this.
+	Slabs shared with other arenas stay mapped until those let go too.
+	*/
+	slabs = std::make_shared<Slabs>(slabSize);
+	sharedSlabs.clear();
+	bump = nullptr;
+	bumpEnd = nullptr;
+	freeList = nullptr;
+	slotsInUse = 0;
+}
+
+void NodeArena::moveSlots(NodeArena &other, const std::size_t numSlots) {
+	/*
+	Hands numSlots slots in use over to other, for nodes that moved to
+	the tree of other. As the slots may lie in any slab this arena uses,
+	other keeps all of them mapped. Freed, the slots join the free list
+	of other.
+	*/
+	slotsInUse -= numSlots;
+	other.slotsInUse += numSlots;
+	std::vector<std::shared_ptr<Slabs>> &shared = other.sharedSlabs;
+	shared.push_back(slabs);
+	shared.insert(shared.end(), sharedSlabs.begin(), sharedSlabs.end());
+	std::sort(shared.begin(), shared.end());
+	shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+	shared.erase(std::remove(shared.begin(), shared.end(), other.slabs), shared.end());
+}
+
+std::size_t NodeArena::getBytesReserved() const {
+	return slabs->slabs.size() * slabSize;
+}
+
+std::size_t NodeArena::getBytesInUse() const {
+	return slotsInUse * slotSize;
+}
+
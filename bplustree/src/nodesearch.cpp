@@ -0,0 +1,178 @@
+#include "nodesearch.hpp"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NODESEARCH_X86
+#endif
+
+// Nodes wider than this are narrowed down by a branchless binary search first.
+static const int LINEAR_SEARCH_WIDTH = 64;
+
+template <typename T>
+static int scalarRankSearch(const T *keys, const int numKeys, const T key) {
+	return std::lower_bound(keys, keys + numKeys, key) - keys;
+}
+
+template <typename T>
+static inline const T *narrowSearchWindow(const T *keys, int &numKeys, const T key) {
+	/*
+	Keeps the invariant that all keys before the window are smaller than
+	key and that the rank lies within the window, i.e. rank equals the
+	window offset plus the number of smaller keys in the window.
+	*/
+	const T *base = keys;
+	while (numKeys > LINEAR_SEARCH_WIDTH) {
+		int half = numKeys / 2;
+		base = base[half] < key ? base + half : base;
+		numKeys -= half;
+	}
+	return base;
+}
+
+#ifdef NODESEARCH_X86
+__attribute__((target("avx2")))
+static int avx2RankSearch(const int *keys, int numKeys, const int key) {
+	const int *base = narrowSearchWindow(keys, numKeys, key);
+	const __m256i needle = _mm256_set1_epi32(key);
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16) {
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i + 8));
+		unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, low)))
+			| _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, high))) << 8;
+		if (mask != 0xFFFF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	if (i + 8 <= numKeys) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i));
+		unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, block)));
+		if (mask != 0xFF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+		i += 8;
+	}
+	while (i < numKeys && base[i] < key) {
+		i++;
+	}
+	return (base - keys) + i;
+}
+
+__attribute__((target("sse4.2")))
+static int sse42RankSearch(const int *keys, int numKeys, const int key) {
+	const int *base = narrowSearchWindow(keys, numKeys, key);
+	const __m128i needle = _mm_set1_epi32(key);
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16) {
+		unsigned int mask = 0;
+		for (int j = 0; j < 4; j++) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + i + 4 * j));
+			mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, block))) << (4 * j);
+		}
+		if (mask != 0xFFFF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	for (; i + 4 <= numKeys; i += 4) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + i));
+		unsigned int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, block)));
+		if (mask != 0xF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	while (i < numKeys && base[i] < key) {
+		i++;
+	}
+	return (base - keys) + i;
+}
+
+__attribute__((target("avx2")))
+static int avx2RankSearch64(const std::int64_t *keys, int numKeys, const std::int64_t key) {
+	const std::int64_t *base = narrowSearchWindow(keys, numKeys, key);
+	const __m256i needle = _mm256_set1_epi64x(key);
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16) {
+		unsigned int mask = 0;
+		for (int j = 0; j < 4; j++) {
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i + 4 * j));
+			mask |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(needle, block))) << (4 * j);
+		}
+		if (mask != 0xFFFF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	for (; i + 4 <= numKeys; i += 4) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i));
+		unsigned int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(needle, block)));
+		if (mask != 0xF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	while (i < numKeys && base[i] < key) {
+		i++;
+	}
+	return (base - keys) + i;
+}
+
+__attribute__((target("sse4.2")))
+static int sse42RankSearch64(const std::int64_t *keys, int numKeys, const std::int64_t key) {
+	const std::int64_t *base = narrowSearchWindow(keys, numKeys, key);
+	const __m128i needle = _mm_set1_epi64x(key);
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16) {
+		unsigned int mask = 0;
+		for (int j = 0; j < 8; j++) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + i + 2 * j));
+			mask |= _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(needle, block))) << (2 * j);
+		}
+		if (mask != 0xFFFF) {
+			return (base - keys) + i + __builtin_popcount(mask);
+		}
+	}
+	while (i < numKeys && base[i] < key) {
+		i++;
+	}
+	return (base - keys) + i;
+}
+#endif
+
+static int (*selectRankSearch())(const int *, const int, const int) {
+#ifdef NODESEARCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return avx2RankSearch;
+	}
+	if (__builtin_cpu_supports("sse4.2")) {
+		return sse42RankSearch;
+	}
+#endif
+	return scalarRankSearch<int>;
+}
+
+static int (*selectRankSearch64())(const std::int64_t *, const int, const std::int64_t) {
+#ifdef NODESEARCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return avx2RankSearch64;
+	}
+	if (__builtin_cpu_supports("sse4.2")) {
+		return sse42RankSearch64;
+	}
+#endif
+	return scalarRankSearch<std::int64_t>;
+}
+
+int (*const rankSearch)(const int *keys, const int numKeys, const int key) = selectRankSearch();
+int (*const rankSearch64)(const std::int64_t *keys, const int numKeys, const std::int64_t key) = selectRankSearch64();
+
+std::string getRankSearchKernelName() {
+#ifdef NODESEARCH_X86
+	if (rankSearch == avx2RankSearch) {
+		return "avx2";
+	}
+	if (rankSearch == sse42RankSearch) {
+		return "sse4.2";
+	}
+#endif
+	return "scalar";
+}
@@ -0,0 +1,108 @@
+#include "valuearena.hpp"
+#include <algorithm>
+#include <bit>
+#include <new>
+
+static const std::size_t CHUNK_SIZE = 1024 * 1024;
+static const std::size_t MIN_BLOCK_SIZE = 16;
+
+ValueArena::ValueArena() :
+	freeLists(),
+	chunks(std::make_shared<Chunks>()),
+	bytesReserved(0),
+	bytesInUse(0),
+	bump(nullptr),
+	bumpEnd(nullptr) {}
+
+ValueArena::~ValueArena() {
+	clear();
+}
+
+ValueArena::Chunks::~Chunks() {
+	for (void *chunk : chunks) {
+		::operator delete(chunk);
+	}
+}
+
+std::size_t ValueArena::roundSize(const std::size_t bytes) {
+	return bytes <= MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : std::bit_ceil(bytes);
+}
+
+int ValueArena::getSizeClass(const std::size_t bytes) {
+	return std::countr_zero(bytes);
+}
+
+void *ValueArena::allocate(const std::size_t bytes) {
+	/*
+	Blocks are rounded up by roundSize. Blocks too large to share a chunk
+	get a chunk of their own, which is still recycled through the free
+	list.
+	*/
+	const std::size_t blockSize = roundSize(bytes);
+	bytesInUse += blockSize;
+	FreeBlock *&freeList = freeLists[getSizeClass(blockSize)];
+	if (freeList) {
+		FreeBlock *block = freeList;
+		freeList = block->next;
+		return block;
+	}
+	if (blockSize > CHUNK_SIZE / 4) {
+		void *chunk = ::operator new(blockSize);
+		chunks->chunks.push_back(chunk);
+		bytesReserved += blockSize;
+		return chunk;
+	}
+	if (static_cast<std::size_t>(bumpEnd - bump) < blockSize) {
+		bump = static_cast<char *>(::operator new(CHUNK_SIZE));
+		bumpEnd = bump + CHUNK_SIZE;
+		chunks->chunks.push_back(bump);
+		bytesReserved += CHUNK_SIZE;
+	}
+	void *block = bump;
+	bump += blockSize;
+	return block;
+}
+
+void ValueArena::deallocate(void *block, const std::size_t bytes) {
+	const std::size_t blockSize = roundSize(bytes);
+	FreeBlock *freeBlock = static_cast<FreeBlock *>(block);
+	FreeBlock *&freeList = freeLists[getSizeClass(blockSize)];
+	freeBlock->next = freeList;
+	freeList = freeBlock;
+	bytesInUse -= blockSize;
+}
+
+void ValueArena::clear() {
+	chunks = std::make_shared<Chunks>();
+	sharedChunks.clear();
+	for (FreeBlock *&freeList : freeLists) {
+		freeList = nullptr;
+	}
+	bytesReserved = 0;
+	bytesInUse = 0;
+	bump = nullptr;
+	bumpEnd = nullptr;
+}
+
+void ValueArena::moveBytes(ValueArena &other, const std::size_t bytes) {
+	/*
+	Hands blocks of bytes in use over to other, for value slots that
+	moved to the tree of other, which keeps all chunks of this arena.
+	*/
+	bytesInUse -= bytes;
+	other.bytesInUse += bytes;
+	std::vector<std::shared_ptr<Chunks>> &shared = other.sharedChunks;
+	shared.push_back(chunks);
+	shared.insert(shared.end(), sharedChunks.begin(), sharedChunks.end());
+	std::sort(shared.begin(), shared.end());
+	shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+	shared.erase(std::remove(shared.begin(), shared.end(), other.chunks), shared.end());
+}
+
+std::size_t ValueArena::getBytesReserved() const {
+	return bytesReserved;
+}
+
+std::size_t ValueArena::getBytesInUse() const {
+	return bytesInUse;
+}
@@ -0,0 +1,200 @@
+#include "valueslot.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VALUESLOT_X86
+#endif
+
+template <typename T>
+void BasicValueSlot<T>::grow(const std::uint32_t newCount, ValueArena &arena) {
+	/*
+	Makes room for newCount values, moving inline values into a block
+	or the current block into a larger one when needed. count is left
+	unchanged for the caller to update.
+	*/
+	if (isInline()) {
+		T *block = static_cast<T *>(arena.allocate(getBlockSize(newCount)));
+		std::copy(inlineValues, inlineValues + count, block);
+		setBlock(block);
+	}
+	else if (getBlockSize(newCount) != getBlockSize(count)) {
+		T *oldBlock = getBlock();
+		T *block = static_cast<T *>(arena.allocate(getBlockSize(newCount)));
+		std::copy(oldBlock, oldBlock + count, block);
+		arena.deallocate(oldBlock, getBlockSize(count));
+		setBlock(block);
+	}
+}
+
+template <typename T>
+void BasicValueSlot<T>::push_back(const T value, ValueArena &arena) {
+	append(&value, &value + 1, arena);
+}
+
+template <typename T>
+void BasicValueSlot<T>::append(const T *first, const T *last, ValueArena &arena) {
+	const std::uint32_t newCount = count + (last - first);
+	if (newCount <= inlineCapacity) {
+		std::copy(first, last, inlineValues + count);
+	}
+	else {
+		grow(newCount, arena);
+		std::copy(first, last, getBlock() + count);
+	}
+	count = newCount;
+}
+
+template <typename T>
+void BasicValueSlot<T>::assign(const T *first, const T *last, ValueArena &arena) {
+	/*
+	Replaces the values. The current block is reused if it has the size
+	the new count calls for, and released if the new values fit inline.
+	*/
+	const std::uint32_t newCount = last - first;
+	if (newCount <= inlineCapacity) {
+		release(arena);
+		std::copy(first, last, inlineValues);
+	}
+	else if (!isInline() && getBlockSize(newCount) == getBlockSize(count)) {
+		std::copy(first, last, getBlock());
+	}
+	else {
+		release(arena);
+		T *block = static_cast<T *>(arena.allocate(getBlockSize(newCount)));
+		std::copy(first, last, block);
+		setBlock(block);
+	}
+	count = newCount;
+}
+
+template <typename T>
+void BasicValueSlot<T>::release(ValueArena &arena) {
+	if (!isInline()) {
+		arena.deallocate(getBlock(), getBlockSize(count));
+	}
+	count = 0;
+}
+
+// Slots folded by the vector kernel before their spilled lists are
+// visited, small enough for the block to still be in L1 by then
+static const std::size_t aggregateBlockSize = 1024;
+// Shorter runs, as in small leaves, do not repay setting up the kernel
+static const std::size_t minKernelSlots = 16;
+
+template <typename T>
+static inline void foldValues(const T *values, const std::uint32_t count, ValueAggregate<T> *result) {
+	for (std::uint32_t i = 0; i < count; i++) {
+		result->sum += values[i];
+		result->min = std::min(result->min, values[i]);
+		result->max = std::max(result->max, values[i]);
+	}
+	result->count += count;
+}
+
+#ifdef VALUESLOT_X86
+__attribute__((target("avx2")))
+static void avx2FoldIntSlots(const void *slots, const std::size_t numSlots, ValueAggregate<int> *result, std::uint64_t *spilled) {
+	/*
+	Folds the inline values of at most aggregateBlockSize slots of int,
+	two 16 byte slots [count, v0, v1, v2] per 256 bit load. Lane j of a
+	slot is live if the slot is inline and its count exceeds j - 1; the
+	count lane itself never is. Spilled slots are marked in the spilled
+	bitmask for the caller.
+	*/
+	const char *base = static_cast<const char *>(slots);
+	const __m256i liveRank = _mm256_setr_epi32(3, 0, 1, 2, 3, 0, 1, 2);
+	const __m256i inlineLimit = _mm256_set1_epi32(4);
+	const __m256i maxValue = _mm256_set1_epi32(std::numeric_limits<int>::max());
+	const __m256i minValue = _mm256_set1_epi32(std::numeric_limits<int>::lowest());
+	__m256i lowSums = _mm256_setzero_si256();
+	__m256i highSums = _mm256_setzero_si256();
+	__m256i counts = _mm256_setzero_si256();
+	__m256i mins = maxValue;
+	__m256i maxs = minValue;
+	std::fill(spilled, spilled + (numSlots + 63) / 64, 0);
+	std::size_t i = 0;
+	for (; i + 2 <= numSlots; i += 2) {
+		const __m256i pair = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i * 16));
+		const __m256i count = _mm256_shuffle_epi32(pair, 0);
+		const __m256i isInline = _mm256_cmpgt_epi32(inlineLimit, count);
+		const __m256i live = _mm256_and_si256(_mm256_cmpgt_epi32(count, liveRank), isInline);
+		const __m256i values = _mm256_and_si256(pair, live);
+		counts = _mm256_sub_epi32(counts, live);
+		lowSums = _mm256_add_epi64(lowSums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+		highSums = _mm256_add_epi64(highSums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+		mins = _mm256_min_epi32(mins, _mm256_blendv_epi8(maxValue, pair, live));
+		maxs = _mm256_max_epi32(maxs, _mm256_blendv_epi8(minValue, pair, live));
+		const std::uint64_t notInline = ~_mm256_movemask_ps(_mm256_castsi256_ps(isInline));
+		spilled[i / 64] |= ((notInline & 1) | (notInline >> 3 & 2)) << (i % 64);
+	}
+	alignas(32) long long sums[8];
+	alignas(32) int laneCounts[8];
+	alignas(32) int laneMins[8];
+	alignas(32) int laneMaxs[8];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(sums), lowSums);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(sums + 4), highSums);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(laneCounts), counts);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(laneMins), mins);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(laneMaxs), maxs);
+	for (int lane = 0; lane < 8; lane++) {
+		result->sum += sums[lane];
+		result->count += laneCounts[lane];
+		result->min = std::min(result->min, laneMins[lane]);
+		result->max = std::max(result->max, laneMaxs[lane]);
+	}
+	if (i < numSlots) {
+		const int *last = reinterpret_cast<const int *>(base + i * 16);
+		if (last[0] <= 3) {
+			foldValues(last + 1, last[0], result);
+		}
+		else {
+			spilled[i / 64] |= std::uint64_t(1) << (i % 64);
+		}
+	}
+}
+#endif
+
+static bool supportsAvx2() {
+#ifdef VALUESLOT_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+static const bool useAvx2 = supportsAvx2();
+
+template <typename T>
+void BasicValueSlot<T>::aggregate(const BasicValueSlot *slots, const std::size_t numSlots, ValueAggregate<T> *result) {
+	/*
+	Adds the values of numSlots consecutive slots to result. With AVX2
+	the inline values of int slots are folded by a vector kernel one
+	block at a time, after which only the spilled lists it marked are
+	visited, while the block is still cached.
+	*/
+#ifdef VALUESLOT_X86
+	if constexpr (std::is_same_v<T, int>) {
+		static_assert(inlineCapacity == 3 && sizeof(BasicValueSlot) == 16, "avx2FoldIntSlots assumes slots of a count and three values");
+		if (useAvx2 && numSlots >= minKernelSlots) {
+			std::uint64_t spilled[aggregateBlockSize / 64];
+			for (std::size_t first = 0; first < numSlots; first += aggregateBlockSize) {
+				const std::size_t blockSlots = std::min(aggregateBlockSize, numSlots - first);
+				avx2FoldIntSlots(slots + first, blockSlots, result, spilled);
+				for (std::size_t word = 0; word < (blockSlots + 63) / 64; word++) {
+					for (std::uint64_t bits = spilled[word]; bits; bits &= bits - 1) {
+						const BasicValueSlot &slot = slots[first + word * 64 + __builtin_ctzll(bits)];
+						foldValues(slot.data(), slot.count, result);
+					}
+				}
+			}
+			return;
+		}
+	}
+#endif
+	for (std::size_t i = 0; i < numSlots; i++) {
+		foldValues(slots[i].data(), slots[i].count, result);
+	}
+}
+
+template class BasicValueSlot<int>;
+template class BasicValueSlot<std::int64_t>;
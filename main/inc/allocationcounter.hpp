@@ -0,0 +1,10 @@
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+/*
+Counts the heap allocations made by the benchmark, through the global
+operator new, so that tests can report allocations per operation.
+*/
+long long getNumAllocations();
+
+#endif
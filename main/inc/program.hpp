@@ -9,14 +9,27 @@
 #define MAGENTA     "\033[35m"        /* Magenta */
 #define CYAN        "\033[36m"        /* Cyan */
 
-class Program {
+/*
+Benchmark driver for trees whose layout and key type are given by
+Traits. Keys are generated as integers and converted with makeKey, so
+every key type sees the same key distribution.
+*/
+template <typename Traits>
+class BasicProgram {
+	typedef BasicBplustree<Traits> Bplustree;
+	typedef BasicParallelBplustree<Traits> ParallelBplustree;
+	typedef typename Traits::Key Key;
+	typedef typename Traits::Compare Compare;
+	typedef typename Bplustree::ValueSlot ValueSlot;
+
 	public:
-		Program(
+		BasicProgram(
 				const std::string treeType,
 				const int order,
 				const int threads,
 				const int trees,
 				const bool bloom,
+				const bool hugePages,
 				const int op,
 				const int opDistrLow,
 				const int opDistrHigh,
@@ -24,35 +37,64 @@ class Program {
 				const int buildDistrHigh,
 				const bool show,
 				const bool batch,
+				const bool relaxedRemoves,
+				const int compactionThreshold,
+				const bool freeze,
+				const bool subtreeCounts,
+				const std::string keyDistr,
 				const int treeSize,
+				const int fillFactor,
+				const std::string partitioner,
+				const bool sharedNothing,
 				const std::string test
 				);
-		~Program();
+		~BasicProgram();
 		void runTest();
 	private:
 		ParallelBplustree *pbtree;
 		Bplustree *btree;
 		std::mt19937_64 gen;
+		const int threads;
 		const int op;
 		const int opDistrLow;
 		const int opDistrHigh;
 		const int buildDistrLow;
 		const int buildDistrHigh;
 		const int treeSize;
+		const int fillFactor;
 		const bool show;
 		const bool batch;
+		const bool relaxedRemoves;
+		const int compactionThreshold;
+		const bool freeze;
+		const bool subtreeCounts;
+		const bool hugePages;
+		const bool sequentialKeys;
 		const std::string test;
 		std::uniform_int_distribution<> opDistr;
 		std::uniform_int_distribution<> buildDistr;
 		void printTreeInfo();
 		void buildRandomTree(const bool runAsOp = false);
+		void freezeTree();
+		std::vector<Key> sampleBuildKeys(const int numKeys);
+		int drawBuildKey(std::uniform_int_distribution<> &distr, const int insertIndex);
 		void searchTest();
 		void deleteTest();
 		void insertTest();
 		void updateTest();
+		void bulkloadTest();
+		void nodeSearchTest();
+		void multiSearchTest();
+		void hintTest();
+		void countRangeTest();
+		void aggregateTest();
+		void removeRangeTest();
+		void scanTest();
 		void printBplustreeInfo();
 		void printParallelBplustreeInfo();
+		void printTreeStats();
 		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep buildRandomBplustree(const int numInserts, std::uniform_int_distribution<> &distr);
+		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep bulkLoadRandomBplustree(Bplustree *tree, const int numPairs, std::uniform_int_distribution<> &distr);
 		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep buildRandomParallelBplustree(const int numInserts, std::uniform_int_distribution<> &distr);
 		std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> searchBplustree();
 		std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> searchParallelBplustree();
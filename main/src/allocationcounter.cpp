@@ -0,0 +1,83 @@
+#include "allocationcounter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	std::atomic<long long> numAllocations(0);
+
+	void *allocate(const std::size_t size) {
+		/*
+		Counted with a relaxed increment, as the count is only read
+		once the threads allocating have finished their work.
+		*/
+		numAllocations.fetch_add(1, std::memory_order_relaxed);
+		void *pointer = std::malloc(size == 0 ? 1 : size);
+		if (!pointer) {
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+
+	void *allocateAligned(const std::size_t size, const std::align_val_t alignment) {
+		numAllocations.fetch_add(1, std::memory_order_relaxed);
+		const std::size_t align = static_cast<std::size_t>(alignment);
+		void *pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+		if (!pointer) {
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+}
+
+long long getNumAllocations() {
+	return numAllocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(const std::size_t size) {
+	return allocate(size);
+}
+
+void *operator new[](const std::size_t size) {
+	return allocate(size);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment) {
+	return allocateAligned(size, alignment);
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment) {
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+	std::free(pointer);
+}
@@ -7,20 +7,30 @@ void printHelpInfo() {
 	std::cout << "\t./optimized [FLAGS] [OPTIONS] --test <test>\n";
 	std::cout << "\n";
 	std::cout << "FLAGS:\n";
-	std::cout << "\t--batch                     " << "Enable batching during test and general build, if --tree option has value parallel\n";
+	std::cout << "\t--batch                     " << "Enable batching during test and general build; with --tree basic only inserts are batched\n";
 	std::cout << "\t--bloom-disable             " << "Disable bloom filter usage if --tree option has value parallel\n";
+	std::cout << "\t--freeze                    " << "Freeze the tree(s) into a read-only image after build for --test values aggregate, count-range, multi-search, scan and search\n";
 	std::cout << "\t--help                      " << "Print this help information\n";
+	std::cout << "\t--huge-pages                " << "Back tree nodes with huge pages where the system provides them\n";
+	std::cout << "\t--relaxed-removes           " << "Leave leaves underfull on remove and rebalance them later by compaction\n";
+	std::cout << "\t--shared-nothing            " << "Give each tree a worker pinned to a core that runs all operations on it without locking, if --tree has value parallel; needs --partitioner hash or range\n";
 	std::cout << "\t--show                      " << "Print the tree after build if --tree-size value <= 1000\n";
+	std::cout << "\t--subtree-counts            " << "Maintain key counts in internal nodes during the test and build, as used by --test count-range\n";
 	std::cout << "\n";
 	std::cout << "OPTIONS:\n";
 	std::cout << "\t--build-distr-high <num>    " << "Highest possible key value during tree build [default: 1000000]\n";
 	std::cout << "\t--build-distr-low <num>     " << "Lowest possible key value during tree build [default: 1]\n";
+	std::cout << "\t--compact-threshold <num>   " << "Removes awaiting compaction, in percent of leaves, that trigger it with --relaxed-removes [default: 25]\n";
+	std::cout << "\t--fill-factor <num>         " << "Node fill factor in percent used by --test bulkload [default: 100]\n";
+	std::cout << "\t--key-distr <distr>         " << "Order of the keys inserted during tree build, random or ascending from the low end of the range [default: uniform] [possible values: sequential, uniform]\n";
+	std::cout << "\t--key-type <type>           " << "Key type of the tree(s), 32 or 64-bit integers or 16 byte binary keys [default: int32] [possible values: int32, int64, key16]\n";
 	std::cout << "\t--op <num>                  " << "Number of operations to perform for the --test value specified [default: 1000000]\n";
 	std::cout << "\t--op-distr-high <num>       " << "Highest possible key value during test operation [default: 1000000]\n";
 	std::cout << "\t--op-distr-low <num>        " << "Lowest possible key value during test operation [default: 1]\n";
 	std::cout << "\t--order <num>               " << "Order of the Bplustree(s) [default: 5]\n";
-	std::cout << "\t--test <test>               " << "The test to carry out [default: ] [possible values: delete, insert, search, update]\n";
-	std::cout << "\t--threads <num>             " << "Number of threads to use in the thread pool if --tree has value parallel [default: std::thread::hardware_concurrency()]\n";
+	std::cout << "\t--partitioner <type>        " << "How keys are placed in the trees if --tree has value parallel, at random or in the tree given by a hash or by ranges learned from a sample of the build keys [default: random] [possible values: hash, random, range]\n";
+	std::cout << "\t--test <test>               " << "The test to carry out [default: ] [possible values: aggregate, bulkload, count-range, delete, hint, insert, multi-search, node-search, remove-range, scan, search, update]\n";
+	std::cout << "\t--threads <num>             " << "Number of threads to use in the thread pool if --tree has value parallel, or for the parallel scan of --test scan [default: std::thread::hardware_concurrency()]\n";
 	std::cout << "\t--tree <type>               " << "The tree data structure to create [default: parallel] [possible values: basic, parallel]\n";
 	std::cout << "\t--tree-size <num>           " << "The number of inserts to do during tree build (overridden by --op if --test has value insert) [default: 1000000]\n";
 	std::cout << "\t--trees <num>               " << "Number of Bplustrees to use if --tree option has value parallel [default: std::thread::hardware_concurrency()]\n";
@@ -30,12 +40,19 @@ std::tuple<std::map<std::string, bool>, std::map<std::string, int>, std::map<std
 	std::map<std::string, bool> flagsBool = {
 		{"--batch", false},
 		{"--bloom-disable", false},
+		{"--freeze", false},
 		{"--help", false},
-		{"--show", false}
+		{"--huge-pages", false},
+		{"--relaxed-removes", false},
+		{"--shared-nothing", false},
+		{"--show", false},
+		{"--subtree-counts", false}
 	};
 	std::map<std::string, int> optionsInt = {
 		{"--build-distr-high", 1000000},
 		{"--build-distr-low", 1},
+		{"--compact-threshold", 25},
+		{"--fill-factor", 100},
 		{"--op", 1000000},
 		{"--op-distr-high", 1000000},
 		{"--op-distr-low", 1},
@@ -45,11 +62,17 @@ std::tuple<std::map<std::string, bool>, std::map<std::string, int>, std::map<std
 		{"--tree-size", 1000000}
 	};
 	std::map<std::string, std::string> optionsString = {
+		{"--key-distr", "uniform"},
+		{"--key-type", "int32"},
+		{"--partitioner", "random"},
 		{"--test", ""},
 		{"--tree", "parallel"}
 	};
 	std::map<std::string, std::vector<std::string>> optionsStringPossibleValues = {
-		{"--test", {"delete", "insert", "search", "update"}},
+		{"--key-distr", {"sequential", "uniform"}},
+		{"--key-type", {"int32", "int64", "key16"}},
+		{"--partitioner", {"hash", "random", "range"}},
+		{"--test", {"aggregate", "bulkload", "count-range", "delete", "hint", "insert", "multi-search", "node-search", "remove-range", "scan", "search", "update"}},
 		{"--tree", {"basic", "parallel"}}
 	};
 	for (int i = 1; i < argc; i++) {
@@ -72,11 +95,20 @@ std::tuple<std::map<std::string, bool>, std::map<std::string, int>, std::map<std
 		}
 	}
 	if (optionsString["--test"] == "" && !flagsBool["--help"]) {
-		throw std::string("Test to run must be specified using --test option [possible values: delete, insert, search, update]\n");
+		throw std::string("Test to run must be specified using --test option [possible values: aggregate, bulkload, count-range, delete, hint, insert, multi-search, node-search, remove-range, scan, search, update]\n");
+	}
+	if (flagsBool["--shared-nothing"] && optionsString["--partitioner"] == "random") {
+		throw std::string("--shared-nothing needs keys to be partitioned, by --partitioner hash or range\n");
 	}
 	return std::make_tuple(flagsBool, optionsInt, optionsString);
 }
 
+template <typename Traits>
+void runProgram(std::map<std::string, bool> &flagsBool, std::map<std::string, int> &optionsInt, std::map<std::string, std::string> &optionsString) {
+	BasicProgram<Traits> program(optionsString["--tree"], optionsInt["--order"], optionsInt["--threads"], optionsInt["--trees"], !flagsBool["--bloom-disable"], flagsBool["--huge-pages"], optionsInt["--op"], optionsInt["--op-distr-low"], optionsInt["--op-distr-high"], optionsInt["--build-distr-low"], optionsInt["--build-distr-high"], flagsBool["--show"], flagsBool["--batch"], flagsBool["--relaxed-removes"], optionsInt["--compact-threshold"], flagsBool["--freeze"], flagsBool["--subtree-counts"], optionsString["--key-distr"], optionsInt["--tree-size"], optionsInt["--fill-factor"], optionsString["--partitioner"], flagsBool["--shared-nothing"], optionsString["--test"]);
+	program.runTest();
+}
+
 int main(int argc, char *argv[]) {
 	std::tuple<std::map<std::string, bool>, std::map<std::string, int>, std::map<std::string, std::string>> result;
 	try {
@@ -97,8 +129,13 @@ int main(int argc, char *argv[]) {
 		printHelpInfo();
 		return 0;
 	}
+	else if (optionsString["--key-type"] == "int64") {
+		runProgram<KeyTraits<std::int64_t>>(flagsBool, optionsInt, optionsString);
+	}
+	else if (optionsString["--key-type"] == "key16") {
+		runProgram<KeyTraits<FixedKey<16>>>(flagsBool, optionsInt, optionsString);
+	}
 	else {
-		Program program(optionsString["--tree"], optionsInt["--order"], optionsInt["--threads"], optionsInt["--trees"], !flagsBool["--bloom-disable"], optionsInt["--op"], optionsInt["--op-distr-low"], optionsInt["--op-distr-high"], optionsInt["--build-distr-low"], optionsInt["--build-distr-high"], flagsBool["--show"], flagsBool["--batch"], optionsInt["--tree-size"], optionsString["--test"]);
-		program.runTest();
+		runProgram<BplustreeTraits<>>(flagsBool, optionsInt, optionsString);
 	}
 }
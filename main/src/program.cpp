@@ -1,13 +1,18 @@
 #include "program.hpp"
+#include "nodesearch.hpp"
+#include "allocationcounter.hpp"
+#include <algorithm>
 #include <iostream>
 
 
-Program::Program(
+template <typename Traits>
+BasicProgram<Traits>::BasicProgram(
 		const std::string treeType,
 		const int order,
 		const int threads,
 		const int trees,
 		const bool bloom,
+		const bool hugePages,
 		const int op,
 		const int opDistrLow,
 		const int opDistrHigh,
@@ -15,10 +20,19 @@ Program::Program(
 		const int buildDistrHigh,
 		const bool show,
 		const bool batch,
+		const bool relaxedRemoves,
+		const int compactionThreshold,
+		const bool freeze,
+		const bool subtreeCounts,
+		const std::string keyDistr,
 		const int treeSize,
+		const int fillFactor,
+		const std::string partitioner,
+		const bool sharedNothing,
 		const std::string test
 		) :
 	gen(std::random_device{}()),
+	threads(threads),
 	op(op),
 	opDistrLow(opDistrLow),
 	opDistrHigh(opDistrHigh),
@@ -28,19 +42,38 @@ Program::Program(
 	buildDistr(buildDistrLow, buildDistrHigh),
 	show(show),
 	batch(batch),
+	relaxedRemoves(relaxedRemoves),
+	compactionThreshold(compactionThreshold),
+	freeze(freeze),
+	subtreeCounts(subtreeCounts),
+	hugePages(hugePages),
+	sequentialKeys(keyDistr == "sequential"),
 	treeSize(treeSize),
+	fillFactor(fillFactor),
 	test(test) {
 		if (treeType == "basic") {
 			pbtree = nullptr;
-			btree = new Bplustree(order);
+			btree = new Bplustree(order, hugePages);
+			btree->setRelaxedRemoves(relaxedRemoves);
+			btree->setSubtreeCounts(subtreeCounts);
 		}
 		else {
-			pbtree = new ParallelBplustree(order, threads, trees, bloom);
+			pbtree = new ParallelBplustree(order, threads, trees, bloom, hugePages);
+			pbtree->setRelaxedRemoves(relaxedRemoves, compactionThreshold / 100.0);
+			pbtree->setSubtreeCounts(subtreeCounts);
+			if (partitioner == "hash") {
+				pbtree->setPartitioner(new HashPartitioner<Traits>(trees));
+			}
+			else if (partitioner == "range") {
+				pbtree->setPartitioner(new RangePartitioner<Traits>(trees, sampleBuildKeys(std::min(treeSize, 100000))));
+			}
+			pbtree->setSharedNothing(sharedNothing);
 			btree = nullptr;
 		}
 	}
 
-Program::~Program() {
+template <typename Traits>
+BasicProgram<Traits>::~BasicProgram() {
 	if (btree) {
 		delete btree;
 	}
@@ -49,7 +82,8 @@ Program::~Program() {
 	}
 }
 
-void Program::runTest() {
+template <typename Traits>
+void BasicProgram<Traits>::runTest() {
 	printTreeInfo();
 	if (test == "delete") {
 		deleteTest();
@@ -63,41 +97,130 @@ void Program::runTest() {
 	else if (test == "update") {
 		updateTest();
 	}
+	else if (test == "bulkload") {
+		bulkloadTest();
+	}
+	else if (test == "node-search") {
+		nodeSearchTest();
+	}
+	else if (test == "multi-search") {
+		multiSearchTest();
+	}
+	else if (test == "hint") {
+		hintTest();
+	}
+	else if (test == "count-range") {
+		countRangeTest();
+	}
+	else if (test == "aggregate") {
+		aggregateTest();
+	}
+	else if (test == "remove-range") {
+		removeRangeTest();
+	}
+	else if (test == "scan") {
+		scanTest();
+	}
 }
 
-void Program::printTreeInfo() {
+template <typename Traits>
+void BasicProgram<Traits>::printTreeInfo() {
 	btree ? printBplustreeInfo() : printParallelBplustreeInfo();
 }
 
-void Program::printBplustreeInfo() {
+template <typename Traits>
+void BasicProgram<Traits>::printBplustreeInfo() {
 	std::cout << MAGENTA << "---Bplustree information--\n" << RESET;
 	std::cout << "order: " << YELLOW << btree->getOrder() << RESET << "\n";
 }
 
-void Program::printParallelBplustreeInfo() {
+template <typename Traits>
+void BasicProgram<Traits>::printParallelBplustreeInfo() {
 	std::cout << MAGENTA << "---ParallelBplustree information--\n" << RESET;
 	std::cout << "order:   " << YELLOW << pbtree->getOrder() << RESET << "\n";
 	std::cout << "trees:   " << YELLOW << pbtree->getNumTrees() << RESET << "\n";
 	std::cout << "threads: " << YELLOW << pbtree->getNumThreads() << RESET << "\n";
 	std::cout << "bloom:   " << YELLOW << pbtree->areBloomFiltersUsed() << RESET << "\n";
+	std::cout << "keys:    " << YELLOW << (pbtree->getPartitioner() ? "partitioned" : "random") << RESET << "\n";
+	std::cout << "owners:  " << YELLOW << (pbtree->isSharedNothing() ? "one pinned worker per tree" : "none") << RESET << "\n";
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::printTreeStats() {
+	std::vector<TreeStats> treeStats = btree ? std::vector<TreeStats>{btree->getStats()} : pbtree->getTreeStats();
+	TreeStats total = {};
+	for (const TreeStats &stats : treeStats) {
+		total.numKeys += stats.numKeys;
+		total.numValues += stats.numValues;
+		total.height = std::max(total.height, stats.height);
+		total.numLeaves += stats.numLeaves;
+		total.numInternalNodes += stats.numInternalNodes;
+		total.numSplits += stats.numSplits;
+		total.numMerges += stats.numMerges;
+		total.numRedistributions += stats.numRedistributions;
+		total.numDeferredRemoves += stats.numDeferredRemoves;
+		total.numAppends += stats.numAppends;
+	}
+	const int order = btree ? btree->getOrder() : pbtree->getOrder();
+	std::cout << "Keys/values stored: " << GREEN << total.numKeys << "/" << total.numValues << "\n" << RESET;
+	std::cout << "Height: " << GREEN << total.height << RESET << ", leaves: " << GREEN << total.numLeaves << RESET << ", internal nodes: " << GREEN << total.numInternalNodes << "\n" << RESET;
+	std::cout << "Leaf fill: " << GREEN << 100.0 * total.numKeys / (total.numLeaves * (order - 1)) << "%\n" << RESET;
+	std::cout << "Splits/merges/redistributions: " << GREEN << total.numSplits << "/" << total.numMerges << "/" << total.numRedistributions << "\n" << RESET;
+	std::cout << "Removes awaiting compaction: " << GREEN << total.numDeferredRemoves << "\n" << RESET;
+	std::cout << "Inserts into the cached rightmost leaf: " << GREEN << total.numAppends << "\n" << RESET;
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::freezeTree() {
+	/*
+	Freezes the tree(s) built into their read-only image when --freeze
+	is given, ahead of the read tests.
+	*/
+	if (!freeze) {
+		return;
+	}
+	std::cout << CYAN << "Freezing...\n" << RESET;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	btree ? btree->freeze() : pbtree->freeze();
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::cout << "Freeze finished in: " << GREEN << (t2 - t1).count() / 1000000 << " ms\n" << RESET;
+	if (btree) {
+		std::cout << "Frozen image size: " << GREEN << btree->getFrozenBytes() / 1024 << " KiB\n" << RESET;
+	}
+	printTreeStats();
 }
 
-void Program::insertTest() {
+template <typename Traits>
+void BasicProgram<Traits>::insertTest() {
 	std::cout << MAGENTA << "---Insert performance test---\n" << RESET;
 	buildRandomTree(true);
 }
 
-void Program::buildRandomTree(const bool runAsOp) {
+template <typename Traits>
+void BasicProgram<Traits>::buildRandomTree(const bool runAsOp) {
 	int numInserts = runAsOp ? op : treeSize;
 	int distrHigh = runAsOp ? opDistrHigh : buildDistrHigh;
 	int distrLow = runAsOp ? opDistrLow : buildDistrLow;
 	std::uniform_int_distribution<> &distr = runAsOp ? opDistr : buildDistr;
 	std::cout << "Tree to be built by " << YELLOW << numInserts << RESET << " inserts\n";
-	std::cout << "Key/value pairs uniformly drawn from range " << YELLOW << "[" << distrLow << ", " << distrHigh << "]\n" << RESET;
+	if (sequentialKeys) {
+		std::cout << "Keys ascending from " << YELLOW << distrLow << RESET << ", values uniformly drawn from range " << YELLOW << "[" << distrLow << ", " << distrHigh << "]\n" << RESET;
+	}
+	else {
+		std::cout << "Key/value pairs uniformly drawn from range " << YELLOW << "[" << distrLow << ", " << distrHigh << "]\n" << RESET;
+	}
 	std::cout << CYAN << "Building...\n" << RESET;
+	const long long allocationsBefore = getNumAllocations();
 	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = btree ? buildRandomBplustree(numInserts, distr) : buildRandomParallelBplustree(numInserts, distr);
+	const long long allocations = getNumAllocations() - allocationsBefore;
 	std::cout << "Build finished in: " << GREEN << ns / 1000000 << " ms\n" << RESET;
 	std::cout << "Build performance: " << GREEN << numInserts / (ns / 1000000000) << " ops\n" << RESET;
+	std::cout << "Heap allocations per operation: " << GREEN << (double)allocations / numInserts << "\n" << RESET;
+	if (btree) {
+		std::cout << "Node memory in use: " << GREEN << btree->getNodeBytesInUse() / 1024 << " KiB of " << btree->getNodeBytesReserved() / 1024 << " KiB reserved\n" << RESET;
+		std::cout << "Value memory in use: " << GREEN << btree->getValueBytesInUse() / 1024 << " KiB of " << btree->getValueBytesReserved() / 1024 << " KiB reserved\n" << RESET;
+	}
+	printTreeStats();
 	if (show) {
 		if (numInserts <= 1000) {
 			std::cout << "---Tree print---\n";
@@ -107,10 +230,44 @@ void Program::buildRandomTree(const bool runAsOp) {
 	}
 }
 
-std::chrono::duration<double, std::ratio<1, 1000000000>>::rep Program::buildRandomBplustree(const int numInserts, std::uniform_int_distribution<> &distr) {
+template <typename Traits>
+std::vector<typename Traits::Key> BasicProgram<Traits>::sampleBuildKeys(const int numKeys) {
+	/*
+	Draws numKeys keys the way the build does, spread evenly over the
+	build for sequential keys, for a range partitioner to learn from.
+	*/
+	std::vector<Key> sample;
+	sample.reserve(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		sample.push_back(makeKey<Key>(drawBuildKey(buildDistr, static_cast<long long>(i) * treeSize / numKeys)));
+	}
+	return sample;
+}
+
+template <typename Traits>
+int BasicProgram<Traits>::drawBuildKey(std::uniform_int_distribution<> &distr, const int insertIndex) {
+	return sequentialKeys ? distr.a() + insertIndex : distr(gen);
+}
+
+template <typename Traits>
+std::chrono::duration<double, std::ratio<1, 1000000000>>::rep BasicProgram<Traits>::buildRandomBplustree(const int numInserts, std::uniform_int_distribution<> &distr) {
+	if (batch) {
+		std::vector<Key> keys;
+		std::vector<int> values;
+		keys.reserve(numInserts);
+		values.reserve(numInserts);
+		for(int i = 0; i < numInserts; i++) {
+			keys.push_back(makeKey<Key>(drawBuildKey(distr, i)));
+			values.push_back(distr(gen));
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		btree->insertBatch(keys, values);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		return (t2 - t1).count();
+	}
 	auto t1 = std::chrono::high_resolution_clock::now();
 	for(int i = 0; i < numInserts; i++) {
-		int k = distr(gen);
+		Key k = makeKey<Key>(drawBuildKey(distr, i));
 		int v = distr(gen);
 		btree->insert(k, v);
 	}
@@ -118,16 +275,465 @@ std::chrono::duration<double, std::ratio<1, 1000000000>>::rep Program::buildRand
 	return (t2 - t1).count();
 }
 
-std::chrono::duration<double, std::ratio<1, 1000000000>>::rep Program::buildRandomParallelBplustree(const int numInserts, std::uniform_int_distribution<> &distr) {
+template <typename Traits>
+void BasicProgram<Traits>::bulkloadTest() {
+	std::cout << MAGENTA << "---Bulk load performance test---\n" << RESET;
+	if (!btree) {
+		std::cout << RED << "Bulk load test requires --tree basic\n" << RESET;
+		return;
+	}
+	std::cout << "Trees to be built from " << YELLOW << op << RESET << " key/value pairs\n";
+	if (sequentialKeys) {
+		std::cout << "Keys ascending from " << YELLOW << opDistrLow << RESET << ", values uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	}
+	else {
+		std::cout << "Key/value pairs uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	}
+	std::cout << "Bulk load fill factor: " << YELLOW << fillFactor << "%\n" << RESET;
+	std::cout << CYAN << "Building by repeated insert...\n" << RESET;
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep insertNs = buildRandomBplustree(op, opDistr);
+	std::cout << "Insert build finished in: " << GREEN << insertNs / 1000000 << " ms\n" << RESET;
+	std::cout << "Insert build performance: " << GREEN << op / (insertNs / 1000000000) << " ops\n" << RESET;
+	std::cout << CYAN << "Building by bulk load...\n" << RESET;
+	// Built like btree, so that both sides use the same allocator and node layout
+	Bplustree bulkTree(btree->getOrder(), hugePages);
+	bulkTree.setSubtreeCounts(subtreeCounts);
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep bulkNs = bulkLoadRandomBplustree(&bulkTree, op, opDistr);
+	std::cout << "Bulk load finished in: " << GREEN << bulkNs / 1000000 << " ms\n" << RESET;
+	std::cout << "Bulk load performance: " << GREEN << op / (bulkNs / 1000000000) << " ops\n" << RESET;
+	std::cout << "Bulk load speedup: " << GREEN << insertNs / bulkNs << "x\n" << RESET;
+	std::cout << "Keys stored after insert build: " << GREEN << btree->getNumKeysStored() << "\n" << RESET;
+	std::cout << "Keys stored after bulk load: " << GREEN << bulkTree.getNumKeysStored() << "\n" << RESET;
+	if (show) {
+		if (op <= 1000) {
+			std::cout << "---Tree print---\n";
+			bulkTree.show();
+			std::cout << "---Tree print end---\n";
+		}
+	}
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::scanTest() {
+	std::cout << MAGENTA << "---Scan performance test---\n" << RESET;
+	if (!btree) {
+		std::cout << RED << "Scan test requires --tree basic\n" << RESET;
+		return;
+	}
+	buildRandomTree();
+	freezeTree();
+	const int numKeys = btree->getNumKeysStored();
+	std::cout << "Full scans over " << YELLOW << numKeys << RESET << " keys\n";
+
+	std::cout << CYAN << "Calling scanFull...\n" << RESET;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	typename Bplustree::ScanResult scanResult = btree->scanFull();
+	long long mapSum = 0;
+	for (const auto &[key, values] : scanResult) {
+		mapSum += values.front() + values.size();
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep mapNs = (t2 - t1).count();
+	std::cout << "scanFull finished in: " << GREEN << mapNs / 1000000 << " ms\n" << RESET;
+	std::cout << "scanFull performance: " << GREEN << numKeys / (mapNs / 1000000000) << " keys/s\n" << RESET;
+
+	std::cout << CYAN << "Stepping cursor...\n" << RESET;
+	t1 = std::chrono::high_resolution_clock::now();
+	long long cursorSum = 0;
+	for (typename Bplustree::Cursor cursor = btree->getCursor(); cursor.isValid(); cursor.next()) {
+		cursorSum += cursor.getValues().front() + cursor.getValues().size();
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep cursorNs = (t2 - t1).count();
+	std::cout << "Cursor scan finished in: " << GREEN << cursorNs / 1000000 << " ms\n" << RESET;
+	std::cout << "Cursor scan performance: " << GREEN << numKeys / (cursorNs / 1000000000) << " keys/s\n" << RESET;
+
+	std::cout << CYAN << "Fetching cursor batches...\n" << RESET;
+	const int batchSize = 1024;
+	std::vector<Key> keys(batchSize);
+	std::vector<const ValueSlot *> values(batchSize);
+	t1 = std::chrono::high_resolution_clock::now();
+	long long batchSum = 0;
+	typename Bplustree::Cursor cursor = btree->getCursor();
+	int numFetched;
+	while ((numFetched = cursor.fetch(keys.data(), values.data(), batchSize)) > 0) {
+		for (int i = 0; i < numFetched; i++) {
+			batchSum += values[i]->front() + values[i]->size();
+		}
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep batchNs = (t2 - t1).count();
+	std::cout << "Batch scan finished in: " << GREEN << batchNs / 1000000 << " ms\n" << RESET;
+	std::cout << "Batch scan performance: " << GREEN << numKeys / (batchNs / 1000000000) << " keys/s\n" << RESET;
+	std::cout << "Cursor speedup over scanFull: " << GREEN << mapNs / cursorNs << "x\n" << RESET;
+	std::cout << "Batch speedup over scanFull: " << GREEN << mapNs / batchNs << "x\n" << RESET;
+
+	std::cout << CYAN << "Scanning in parallel on " << threads << " threads...\n" << RESET;
+	thread_pool pool(threads);
+	typename Bplustree::Cursor first = btree->getCursor();
+	typename Bplustree::Cursor last = btree->getCursor();
+	last.seekToLast();
+	std::vector<long long> partitionSums(first.isValid() ? btree->getScanPartitions(first.getKey(), last.getKey(), threads).size() : 0);
+	t1 = std::chrono::high_resolution_clock::now();
+	btree->parallelScanFull(pool, [&partitionSums](const std::size_t partition, const Key *keys, const ValueSlot *const *values, const int count) {
+		long long sum = 0;
+		for (int i = 0; i < count; i++) {
+			sum += values[i]->front() + values[i]->size();
+		}
+		partitionSums[partition] += sum;
+	});
+	long long parallelSum = 0;
+	for (long long sum : partitionSums) {
+		parallelSum += sum;
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep parallelNs = (t2 - t1).count();
+	std::cout << "Parallel scan finished in: " << GREEN << parallelNs / 1000000 << " ms\n" << RESET;
+	std::cout << "Parallel scan performance: " << GREEN << numKeys / (parallelNs / 1000000000) << " keys/s\n" << RESET;
+	std::cout << "Parallel speedup over cursor scan: " << GREEN << cursorNs / parallelNs << "x\n" << RESET;
+	if (mapSum != cursorSum || mapSum != batchSum || mapSum != parallelSum) {
+		std::cout << RED << "Scan results differ\n" << RESET;
+	}
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::nodeSearchTest() {
+	std::cout << MAGENTA << "---Node search kernel microbenchmark---\n" << RESET;
+	std::cout << "Rank search kernel: " << YELLOW << getRankSearchKernelName() << RESET << "\n";
+	std::cout << "Searches per order: " << YELLOW << op << RESET << "\n";
+	std::cout << "Keys uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	const int numNodes = 1024;
+	for (int order = 4; order <= 256; order *= 2) {
+		const int numKeys = order - 1;
+		std::vector<Key> nodeKeys(numNodes * numKeys);
+		for (int i = 0; i < numNodes; i++) {
+			for (int j = 0; j < numKeys; j++) {
+				nodeKeys[i * numKeys + j] = makeKey<Key>(opDistr(gen));
+			}
+			std::sort(nodeKeys.begin() + i * numKeys, nodeKeys.begin() + (i + 1) * numKeys, Compare());
+		}
+		std::vector<int> searchNodes;
+		std::vector<Key> searchKeys;
+		searchNodes.reserve(op);
+		searchKeys.reserve(op);
+		for (int i = 0; i < op; i++) {
+			searchNodes.push_back((gen() % numNodes) * numKeys);
+			searchKeys.push_back(makeKey<Key>(opDistr(gen)));
+		}
+		long long lowerBoundSum = 0;
+		auto t1 = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < op; i++) {
+			const Key *keys = nodeKeys.data() + searchNodes[i];
+			lowerBoundSum += std::lower_bound(keys, keys + numKeys, searchKeys[i], Compare()) - keys;
+		}
+		auto t2 = std::chrono::high_resolution_clock::now();
+		long long rankSearchSum = 0;
+		for (int i = 0; i < op; i++) {
+			rankSearchSum += keyRankSearch<Key, Compare>(nodeKeys.data() + searchNodes[i], numKeys, searchKeys[i]);
+		}
+		auto t3 = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep lowerBoundNs = (t2 - t1).count();
+		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep rankSearchNs = (t3 - t2).count();
+		std::cout << "order " << YELLOW << order << RESET;
+		std::cout << ": std::lower_bound " << GREEN << lowerBoundNs / op << " ns" << RESET;
+		std::cout << ", rankSearch " << GREEN << rankSearchNs / op << " ns" << RESET;
+		std::cout << ", speedup " << GREEN << lowerBoundNs / rankSearchNs << "x" << RESET;
+		std::cout << (lowerBoundSum == rankSearchSum ? "" : RED " (results differ)" RESET) << "\n";
+	}
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::multiSearchTest() {
+	std::cout << MAGENTA << "---Multi-search group size sweep---\n" << RESET;
+	if (!btree) {
+		std::cout << RED << "Multi-search test requires --tree basic\n" << RESET;
+		return;
+	}
+	buildRandomTree();
+	freezeTree();
+	std::cout << "Lookups per run: " << YELLOW << op << RESET << "\n";
+	std::cout << "Keys to search for uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	std::vector<Key> keys;
+	keys.reserve(op);
+	for (int i = 0; i < op; i++) {
+		keys.push_back(makeKey<Key>(opDistr(gen)));
+	}
+	int searchHits = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < op; i++) {
+		searchHits += btree->search(keys[i]) != nullptr;
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep searchNs = (t2 - t1).count();
+	std::cout << "search: " << GREEN << searchNs / op << " ns" << RESET << " per lookup, " << GREEN << searchHits << RESET << " hits\n";
+	std::vector<const ValueSlot *> results;
+	for (int groupSize = 1; groupSize <= Bplustree::maxGroupSize; groupSize *= 2) {
+		t1 = std::chrono::high_resolution_clock::now();
+		btree->multiSearch(keys, results, groupSize);
+		t2 = std::chrono::high_resolution_clock::now();
+		int hits = 0;
+		for (const ValueSlot *result : results) {
+			hits += result != nullptr;
+		}
+		std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = (t2 - t1).count();
+		std::cout << "multiSearch group size " << YELLOW << groupSize << RESET;
+		std::cout << ": " << GREEN << ns / op << " ns" << RESET << " per lookup";
+		std::cout << ", speedup " << GREEN << searchNs / ns << "x" << RESET;
+		std::cout << (hits == searchHits ? "" : RED " (results differ)" RESET) << "\n";
+	}
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::hintTest() {
+	/*
+	Compares lookups descending from the root with lookups through a
+	SearchHint on keys with locality: a random walk over the op range
+	taking steps of at most 64.
+	*/
+	std::cout << MAGENTA << "---Search hint locality test---\n" << RESET;
+	if (!btree) {
+		std::cout << RED << "Hint test requires --tree basic\n" << RESET;
+		return;
+	}
+	buildRandomTree();
+	std::cout << "Lookups per run: " << YELLOW << op << RESET << "\n";
+	std::cout << "Keys to search for by a random walk with steps in " << YELLOW << "[-64, 64]" << RESET << " over range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	std::uniform_int_distribution<> stepDistr(-64, 64);
+	std::vector<Key> keys;
+	keys.reserve(op);
+	int walk = opDistr(gen);
+	for (int i = 0; i < op; i++) {
+		walk = std::clamp(walk + stepDistr(gen), opDistrLow, opDistrHigh);
+		keys.push_back(makeKey<Key>(walk));
+	}
+	int searchHits = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < op; i++) {
+		searchHits += btree->search(keys[i]) != nullptr;
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep searchNs = (t2 - t1).count();
+	std::cout << "search: " << GREEN << searchNs / op << " ns" << RESET << " per lookup, " << GREEN << searchHits << RESET << " hits\n";
+	typename Bplustree::SearchHint hint;
+	int hintedHits = 0;
+	t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < op; i++) {
+		hintedHits += btree->search(keys[i], &hint) != nullptr;
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep hintedNs = (t2 - t1).count();
+	std::cout << "hinted search: " << GREEN << hintedNs / op << " ns" << RESET << " per lookup, " << GREEN << hintedHits << RESET << " hits";
+	std::cout << ", speedup " << GREEN << searchNs / hintedNs << "x" << RESET;
+	std::cout << (hintedHits == searchHits ? "" : RED " (results differ)" RESET) << "\n";
+	std::cout << "Hinted leaf/sibling/descent: " << GREEN << 100.0 * hint.getNumHits() / op << "%/" << 100.0 * hint.getNumWalks() / op << "%/" << 100.0 * hint.getNumDescents() / op << "%\n" << RESET;
+	typename Bplustree::SearchHint updateHint;
+	const std::vector<int> values = {1};
+	t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < op; i++) {
+		btree->update(keys[i], values, &updateHint, true);
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep updateNs = (t2 - t1).count();
+	std::cout << "hinted update or insert: " << GREEN << updateNs / op << " ns" << RESET << " per operation";
+	std::cout << ", leaf/sibling/descent " << GREEN << 100.0 * updateHint.getNumHits() / op << "%/" << 100.0 * updateHint.getNumWalks() / op << "%/" << 100.0 * updateHint.getNumDescents() / op << "%\n" << RESET;
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::countRangeTest() {
+	/*
+	Counts the keys of random ranges with countRange, and for the basic
+	tree compares it with counting the result of scan on a sample of the
+	ranges. Without --subtree-counts the counts are enabled after build.
+	*/
+	std::cout << MAGENTA << "---Range count performance test---\n" << RESET;
+	buildRandomTree();
+	freezeTree();
+	if (!subtreeCounts) {
+		std::cout << CYAN << "Counting subtrees...\n" << RESET;
+		auto t1 = std::chrono::high_resolution_clock::now();
+		btree ? btree->setSubtreeCounts(true) : pbtree->setSubtreeCounts(true);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		std::cout << "Subtree counts enabled in: " << GREEN << (t2 - t1).count() / 1000000 << " ms\n" << RESET;
+	}
+	std::cout << "Range counts to perform: " << YELLOW << op << RESET << "\n";
+	std::cout << "Range ends uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	std::vector<std::pair<Key, Key>> ranges;
+	ranges.reserve(op);
+	for (int i = 0; i < op; i++) {
+		const int start = opDistr(gen);
+		const int end = opDistr(gen);
+		ranges.emplace_back(makeKey<Key>(std::min(start, end)), makeKey<Key>(std::max(start, end)));
+	}
+	std::cout << CYAN << "Calling countRange...\n" << RESET;
+	long long countSum = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (const auto &[start, end] : ranges) {
+		countSum += btree ? btree->countRange(start, end) : pbtree->countRange(start, end);
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep countNs = (t2 - t1).count();
+	std::cout << "countRange finished in: " << GREEN << countNs / 1000000 << " ms\n" << RESET;
+	std::cout << "countRange performance: " << GREEN << op / (countNs / 1000000000) << " ops\n" << RESET;
+	if (!btree) {
+		return;
+	}
+	const int numScans = std::min(op, 100);
+	std::cout << CYAN << "Counting " << numScans << " ranges by scan...\n" << RESET;
+	long long scanSum = 0;
+	countSum = 0;
+	t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < numScans; i++) {
+		scanSum += btree->scan(ranges[i].first, ranges[i].second).size();
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < numScans; i++) {
+		countSum += btree->countRange(ranges[i].first, ranges[i].second);
+	}
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep scanNs = (t2 - t1).count();
+	std::cout << "Scan count performance: " << GREEN << numScans / (scanNs / 1000000000) << " ops\n" << RESET;
+	std::cout << "countRange speedup over scan: " << GREEN << (scanNs / numScans) / (countNs / op) << "x\n" << RESET;
+	if (countSum != scanSum) {
+		std::cout << RED << "Range counts differ\n" << RESET;
+	}
+	std::cout << CYAN << "Calling select and rank...\n" << RESET;
+	const int numKeys = btree->getNumKeysStored();
+	std::uniform_int_distribution<> rankDistr(0, std::max(0, numKeys - 1));
+	int rankMismatches = 0;
+	t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; numKeys > 0 && i < op; i++) {
+		const int rank = rankDistr(gen);
+		Key key;
+		btree->select(rank, &key);
+		rankMismatches += btree->rank(key) != rank;
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep selectNs = (t2 - t1).count();
+	std::cout << "select and rank performance: " << GREEN << op / (selectNs / 1000000000) << " ops\n" << RESET;
+	if (rankMismatches) {
+		std::cout << RED << "Ranks of selected keys differ\n" << RESET;
+	}
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::aggregateTest() {
+	/*
+	Computes count, sum, min and max of the values of random ranges with
+	aggregate, and for the basic tree compares it with folding the values
+	fetched by a cursor, and with parallelAggregate over all keys.
+	*/
+	std::cout << MAGENTA << "---Range aggregate performance test---\n" << RESET;
+	buildRandomTree();
+	freezeTree();
+	std::cout << "Range aggregates to perform: " << YELLOW << op << RESET << "\n";
+	std::cout << "Range ends uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	std::vector<std::pair<Key, Key>> ranges;
+	ranges.reserve(op);
+	for (int i = 0; i < op; i++) {
+		const int start = opDistr(gen);
+		const int end = opDistr(gen);
+		ranges.emplace_back(makeKey<Key>(std::min(start, end)), makeKey<Key>(std::max(start, end)));
+	}
+	std::cout << CYAN << "Calling aggregate...\n" << RESET;
+	long long valueSum = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (const auto &[start, end] : ranges) {
+		valueSum += (btree ? btree->aggregate(start, end) : pbtree->aggregate(start, end)).sum;
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep aggregateNs = (t2 - t1).count();
+	std::cout << "aggregate finished in: " << GREEN << aggregateNs / 1000000 << " ms\n" << RESET;
+	std::cout << "aggregate performance: " << GREEN << op / (aggregateNs / 1000000000) << " ops\n" << RESET;
+	if (!btree) {
+		return;
+	}
+	const int numFolds = std::min(op, 100);
+	std::cout << CYAN << "Folding " << numFolds << " ranges by cursor...\n" << RESET;
+	const int batchSize = 1024;
+	std::vector<Key> keys(batchSize);
+	std::vector<const ValueSlot *> values(batchSize);
+	typename Bplustree::Aggregate cursorAggregate;
+	t1 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < numFolds; i++) {
+		typename Bplustree::Cursor cursor = btree->getCursor();
+		cursor.seek(ranges[i].first);
+		int numFetched;
+		while ((numFetched = cursor.fetch(keys.data(), values.data(), batchSize, ranges[i].second, true)) > 0) {
+			for (int j = 0; j < numFetched; j++) {
+				for (const int value : *values[j]) {
+					cursorAggregate.sum += value;
+					cursorAggregate.min = std::min(cursorAggregate.min, value);
+					cursorAggregate.max = std::max(cursorAggregate.max, value);
+				}
+				cursorAggregate.count += values[j]->size();
+			}
+		}
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep cursorNs = (t2 - t1).count();
+	typename Bplustree::Aggregate treeAggregate;
+	for (int i = 0; i < numFolds; i++) {
+		treeAggregate.add(btree->aggregate(ranges[i].first, ranges[i].second));
+	}
+	std::cout << "Cursor fold performance: " << GREEN << numFolds / (cursorNs / 1000000000) << " ops\n" << RESET;
+	std::cout << "aggregate speedup over cursor fold: " << GREEN << (cursorNs / numFolds) / (aggregateNs / op) << "x\n" << RESET;
+	if (treeAggregate.count != cursorAggregate.count || treeAggregate.sum != cursorAggregate.sum || treeAggregate.min != cursorAggregate.min || treeAggregate.max != cursorAggregate.max) {
+		std::cout << RED << "Range aggregates differ\n" << RESET;
+	}
+
+	typename Bplustree::Cursor first = btree->getCursor();
+	typename Bplustree::Cursor last = btree->getCursor();
+	last.seekToLast();
+	if (!first.isValid()) {
+		return;
+	}
+	const Key low = first.getKey();
+	const Key high = last.getKey();
+	std::cout << CYAN << "Aggregating all keys...\n" << RESET;
+	t1 = std::chrono::high_resolution_clock::now();
+	const typename Bplustree::Aggregate fullAggregate = btree->aggregate(low, high);
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep fullNs = (t2 - t1).count();
+	std::cout << "Full aggregate performance: " << GREEN << fullAggregate.count / (fullNs / 1000000000) << " values/s\n" << RESET;
+	std::cout << CYAN << "Aggregating all keys in parallel on " << threads << " threads...\n" << RESET;
+	thread_pool pool(threads);
+	t1 = std::chrono::high_resolution_clock::now();
+	const typename Bplustree::Aggregate parallelAggregate = btree->parallelAggregate(pool, low, high);
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep parallelNs = (t2 - t1).count();
+	std::cout << "Parallel aggregate performance: " << GREEN << parallelAggregate.count / (parallelNs / 1000000000) << " values/s\n" << RESET;
+	std::cout << "Parallel speedup over aggregate: " << GREEN << fullNs / parallelNs << "x\n" << RESET;
+	if (fullAggregate.count != parallelAggregate.count || fullAggregate.sum != parallelAggregate.sum || fullAggregate.min != parallelAggregate.min || fullAggregate.max != parallelAggregate.max) {
+		std::cout << RED << "Parallel aggregates differ\n" << RESET;
+	}
+}
+
+template <typename Traits>
+std::chrono::duration<double, std::ratio<1, 1000000000>>::rep BasicProgram<Traits>::bulkLoadRandomBplustree(Bplustree *tree, const int numPairs, std::uniform_int_distribution<> &distr) {
+	std::vector<Key> keys;
+	std::vector<int> values;
+	keys.reserve(numPairs);
+	values.reserve(numPairs);
+	for (int i = 0; i < numPairs; i++) {
+		keys.push_back(makeKey<Key>(drawBuildKey(distr, i)));
+		values.push_back(distr(gen));
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	tree->bulkLoad(keys, values, static_cast<double>(fillFactor) / 100);
+	auto t2 = std::chrono::high_resolution_clock::now();
+	return (t2 - t1).count();
+}
+
+template <typename Traits>
+std::chrono::duration<double, std::ratio<1, 1000000000>>::rep BasicProgram<Traits>::buildRandomParallelBplustree(const int numInserts, std::uniform_int_distribution<> &distr) {
 	auto t1 = std::chrono::high_resolution_clock::now();
 	auto t2 = std::chrono::high_resolution_clock::now();
-	std::vector<int> keys;
+	std::vector<Key> keys;
 	std::vector<int> values;
 	if (batch) {
 		keys.reserve(numInserts);
 		values.reserve(numInserts);
 		for(int i = 0; i < numInserts; i++) {
-			keys.push_back(distr(gen));
+			keys.push_back(makeKey<Key>(drawBuildKey(distr, i)));
 			values.push_back(distr(gen));
 		}
 		t1 = std::chrono::high_resolution_clock::now();
@@ -137,7 +743,7 @@ std::chrono::duration<double, std::ratio<1, 1000000000>>::rep Program::buildRand
 	else {
 		t1 = std::chrono::high_resolution_clock::now();
 		for(int i = 0; i < numInserts; i++) {
-			int k = distr(gen);
+			Key k = makeKey<Key>(drawBuildKey(distr, i));
 			int v = distr(gen);
 			pbtree->insert(k, v);
 		}
@@ -150,12 +756,16 @@ std::chrono::duration<double, std::ratio<1, 1000000000>>::rep Program::buildRand
 	return (t3 - t1).count();
 };
 
-void Program::searchTest() {
+template <typename Traits>
+void BasicProgram<Traits>::searchTest() {
 	std::cout << MAGENTA << "---Search performance test---\n" << RESET;
 	buildRandomTree();
+	freezeTree();
 	std::cout << "Search operations to perform: " << YELLOW << op << RESET << "\n";
 	std::cout << "Keys to search for uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	const long long allocationsBefore = getNumAllocations();
 	std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> result = btree ? searchBplustree() : searchParallelBplustree();
+	const long long allocations = getNumAllocations() - allocationsBefore;
 	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = std::get<0>(result);
 	int hits = std::get<1>(result);
 	int misses = std::get<2>(result);
@@ -163,14 +773,16 @@ void Program::searchTest() {
 	std::cout << "Search key hits: " << GREEN << hits << "\n" << RESET;
 	std::cout << "Search key misses: " << GREEN << misses << "\n" << RESET;
 	std::cout << "Search performance: " << GREEN << op / (ns / 1000000000) << " ops\n" << RESET;
+	std::cout << "Heap allocations per operation: " << GREEN << (double)allocations / op << "\n" << RESET;
 }
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::searchBplustree() {
-	std::vector<const std::vector<int> *> searchResult;
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::searchBplustree() {
+	std::vector<const ValueSlot *> searchResult;
 	std::cout << CYAN << "Calling search...\n" << RESET;
 	auto t1 = std::chrono::high_resolution_clock::now();
 	for (int i = 0; i < op; i++) {
-		int k = opDistr(gen);
+		Key k = makeKey<Key>(opDistr(gen));
 		searchResult.push_back(std::move(btree->search(k)));
 	}
 	auto t2 = std::chrono::high_resolution_clock::now();
@@ -184,21 +796,22 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	return std::make_tuple((t2 - t1).count(), hits, op - hits);
 };
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::searchParallelBplustree() {
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::searchParallelBplustree() {
 	auto t1 = std::chrono::high_resolution_clock::now();
 	auto t2 = std::chrono::high_resolution_clock::now();
 	auto t3 = std::chrono::high_resolution_clock::now();
 	int hits = 0;
 	if (batch) {
 		std::cout << CYAN << "Generating keys for batch search...\n" << RESET;
-		std::vector<int> keys;
+		std::vector<Key> keys;
 		keys.reserve(op);
 		for (int i = 0; i < op; i++) {
-			keys.push_back(opDistr(gen));
+			keys.push_back(makeKey<Key>(opDistr(gen)));
 		}
 		std::cout << CYAN << "Calling search...\n" << RESET;
 		t1 = std::chrono::high_resolution_clock::now();
-		std::vector<std::vector<const std::vector<int> *>> result = pbtree->search(keys);
+		std::vector<std::vector<const ValueSlot *>> result = pbtree->search(keys);
 		t2 = std::chrono::high_resolution_clock::now();
 		pbtree->waitForWorkToFinish();
 		t3 = std::chrono::high_resolution_clock::now();
@@ -213,19 +826,19 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 		}
 	}
 	else {
-		std::vector<std::future<std::vector<std::future<const std::vector<int> *>>>> searchFutures;
+		std::vector<std::future<std::vector<std::future<const ValueSlot *>>>> searchFutures;
 		searchFutures.reserve(op);
-		std::vector<std::vector<std::future<const std::vector<int> *>>> searchResult;
+		std::vector<std::vector<std::future<const ValueSlot *>>> searchResult;
 		searchResult.reserve(op);
 		std::cout << CYAN << "Calling search...\n" << RESET;
 		t1 = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < op; i++) {
-			int k = opDistr(gen);
+			Key k = makeKey<Key>(opDistr(gen));
 			searchFutures.push_back(pbtree->search(k));
 		}
 		t2 = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < op; i++) {
-			std::vector<std::future<const std::vector<int> *>> temporaryResult = searchFutures[i].get();
+			std::vector<std::future<const ValueSlot *>> temporaryResult = searchFutures[i].get();
 			for (int j = 0; j < temporaryResult.size(); j++) {
 				temporaryResult[j].wait();
 			}
@@ -247,12 +860,52 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	return std::make_tuple((t3 - t1).count(), hits, op - hits);
 };
 
-void Program::deleteTest() {
+template <typename Traits>
+void BasicProgram<Traits>::removeRangeTest() {
+	/*
+	Removes op random ranges with removeRange, which drops the subtrees
+	a range covers whole instead of removing their keys one by one.
+	*/
+	std::cout << MAGENTA << "---Range remove performance test---\n" << RESET;
+	buildRandomTree();
+	std::cout << "Range removes to perform: " << YELLOW << op << RESET << "\n";
+	std::cout << "Range ends uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	std::vector<std::pair<Key, Key>> ranges;
+	ranges.reserve(op);
+	for (int i = 0; i < op; i++) {
+		const int start = opDistr(gen);
+		const int end = opDistr(gen);
+		ranges.emplace_back(makeKey<Key>(std::min(start, end)), makeKey<Key>(std::max(start, end)));
+	}
+	std::cout << CYAN << "Calling removeRange...\n" << RESET;
+	long long numRemoved = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (const auto &[start, end] : ranges) {
+		numRemoved += btree ? btree->removeRange(start, end) : pbtree->removeRange(start, end);
+	}
+	if (pbtree) {
+		pbtree->waitForWorkToFinish();
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = (t2 - t1).count();
+	std::cout << "removeRange finished in: " << GREEN << ns / 1000000 << " ms\n" << RESET;
+	std::cout << "Keys removed: " << GREEN << numRemoved << "\n" << RESET;
+	std::cout << "removeRange performance: " << GREEN << op / (ns / 1000000000) << " ops, " << numRemoved / (ns / 1000000000) << " keys/s\n" << RESET;
+	printTreeStats();
+}
+
+template <typename Traits>
+void BasicProgram<Traits>::deleteTest() {
 	std::cout << MAGENTA << "---Delete performance test---\n" << RESET;
 	buildRandomTree();
 	std::cout << "Delete operations to perform: " << YELLOW << op << "\n" << RESET;
 	std::cout << "Keys to search for uniformly drawn from range " << YELLOW << "[" << opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
+	if (relaxedRemoves) {
+		std::cout << "Removes " << YELLOW << "relaxed" << RESET << ", compaction at " << YELLOW << compactionThreshold << "%" << RESET << " of leaves\n";
+	}
+	const long long allocationsBefore = getNumAllocations();
 	std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> result = btree ? deleteBplustree() : deleteParallelBplustree();
+	const long long allocations = getNumAllocations() - allocationsBefore;
 	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = std::get<0>(result);
 	int oldNumKeys = std::get<1>(result);
 	int newNumKeys = std::get<2>(result);
@@ -260,21 +913,32 @@ void Program::deleteTest() {
 	std::cout << "Tree size before delete: " << RED << oldNumKeys << "\n" << RESET;
 	std::cout << "Tree size after delete: " << GREEN << newNumKeys << "\n" << RESET;
 	std::cout << "Delete performance: " << GREEN << op / (ns / 1000000000) << " ops\n" << RESET;
+	std::cout << "Heap allocations per operation: " << GREEN << (double)allocations / op << "\n" << RESET;
+	printTreeStats();
 }
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::deleteBplustree() {
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::deleteBplustree() {
 	int oldNumKeys = btree->getNumKeysStored();
 	std::cout << CYAN << "Calling remove...\n" << RESET;
 	auto t1 = std::chrono::high_resolution_clock::now();
 	for (int i = 0; i < op; i++) {
-		btree->remove(opDistr(gen));
+		btree->remove(makeKey<Key>(opDistr(gen)));
 	}
 	auto t2 = std::chrono::high_resolution_clock::now();
+	if (relaxedRemoves && btree->needsCompaction(compactionThreshold / 100.0)) {
+		std::cout << CYAN << "Compacting...\n" << RESET;
+		auto t3 = std::chrono::high_resolution_clock::now();
+		btree->compact();
+		auto t4 = std::chrono::high_resolution_clock::now();
+		std::cout << "Compaction finished in: " << GREEN << (t4 - t3).count() / 1000000 << " ms\n" << RESET;
+	}
 	int newNumKeys = btree->getNumKeysStored();
 	return std::make_tuple((t2 - t1).count(), oldNumKeys, newNumKeys);
 }
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::deleteParallelBplustree() {
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::deleteParallelBplustree() {
 	std::vector<std::future<std::vector<std::future<bool>>>> deleteFutures;
 	deleteFutures.reserve(op);
 	auto t1 = std::chrono::high_resolution_clock::now();
@@ -286,10 +950,10 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	}
 	if (batch) {
 		std::cout << CYAN << "Generating keys for batch delete...\n" << RESET;
-		std::vector<int> keys;
+		std::vector<Key> keys;
 		keys.reserve(op);
 		for (int i = 0; i < op; i++) {
-			keys.push_back(opDistr(gen));
+			keys.push_back(makeKey<Key>(opDistr(gen)));
 		}
 		std::cout << CYAN << "Calling remove...\n" << RESET;
 		t1 = std::chrono::high_resolution_clock::now();
@@ -302,7 +966,7 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 		std::cout << CYAN << "Calling remove...\n" << RESET;
 		t1 = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < op; i++) {
-			deleteFutures.push_back(pbtree->remove(opDistr(gen)));
+			deleteFutures.push_back(pbtree->remove(makeKey<Key>(opDistr(gen))));
 		}
 		t2 = std::chrono::high_resolution_clock::now();
 		for (int i = 0; i < op; i++) {
@@ -322,14 +986,17 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	return std::make_tuple((t3 - t1).count(), oldNumKeys, newNumKeys);
 }
 
-void Program::updateTest() {
+template <typename Traits>
+void BasicProgram<Traits>::updateTest() {
 	std::cout << MAGENTA << "---Update performance test---\n" << RESET;
 	buildRandomTree();
 	std::cout << "Update operations to perform: " << YELLOW << op << "\n" << RESET;
 	std::cout << "Keys to update uniformly drawn from range " << YELLOW << "["<< opDistrLow << ", " << opDistrHigh << "]\n" << RESET;
 	std::cout << "Updates performed with" << YELLOW << " single values only\n" << RESET;
 	std::cout << YELLOW << "insertIfNotFound = true" << RESET << " for all updates\n";
+	const long long allocationsBefore = getNumAllocations();
 	std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> result = btree ? updateBplustree() : updateParallelBplustree();
+	const long long allocations = getNumAllocations() - allocationsBefore;
 	std::chrono::duration<double, std::ratio<1, 1000000000>>::rep ns = std::get<0>(result);
 	int oldNumKeys = std::get<1>(result);
 	int newNumKeys = std::get<2>(result);
@@ -337,14 +1004,16 @@ void Program::updateTest() {
 	std::cout << "Tree size before update: " << RED << oldNumKeys << "\n" << RESET;
 	std::cout << "Tree size after update: " << GREEN << newNumKeys << "\n" << RESET;
 	std::cout << "Update performance: " << GREEN << op / (ns / 1000000000) << " ops\n" << RESET;
+	std::cout << "Heap allocations per operation: " << GREEN << (double)allocations / op << "\n" << RESET;
 }
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::updateBplustree() {
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::updateBplustree() {
 	int oldNumKeys = btree->getNumKeysStored();
 	std::cout << CYAN << "Calling update...\n" << RESET;
 	auto t1 = std::chrono::high_resolution_clock::now();
 	for (int i = 0; i < op; i++) {
-		int k = opDistr(gen);
+		Key k = makeKey<Key>(opDistr(gen));
 		std::vector<int> v = {i};
 		btree->update(k, v, true);
 	}
@@ -353,14 +1022,15 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	return std::make_tuple((t2 - t1).count(), oldNumKeys, newNumKeys);
 }
 
-std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> Program::updateParallelBplustree() {
+template <typename Traits>
+std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, int> BasicProgram<Traits>::updateParallelBplustree() {
 	std::cout << CYAN << "Generating keys and values...\n" << RESET;
-	std::vector<int> keys;
+	std::vector<Key> keys;
 	keys.reserve(op);
 	std::vector<std::vector<int>> values;
 	values.reserve(op);
 	for (int i = 0; i < op; i++) {
-		keys.push_back(opDistr(gen));
+		keys.push_back(makeKey<Key>(opDistr(gen)));
 		values.push_back({i});
 	}
 	int oldNumKeys = 0;
@@ -393,3 +1063,7 @@ std::tuple<std::chrono::duration<double, std::ratio<1, 1000000000>>::rep, int, i
 	std::cout << "Time spent waiting for work to finish: " << GREEN <<  (t3 - t2).count() / 1000000 << " ms\n" << RESET;
 	return std::make_tuple((t3 - t1).count(), oldNumKeys, newNumKeys);
 }
+
+template class BasicProgram<BplustreeTraits<>>;
+template class BasicProgram<KeyTraits<std::int64_t>>;
+template class BasicProgram<KeyTraits<FixedKey<16>>>;
@@ -1,24 +1,48 @@
 #include "bplustree.hpp"
+#include "partitioner.hpp"
+#include "partitionworkers.hpp"
 #include "thread_pool.hpp"
 #include "bloom_filter.hpp"
+#include <atomic>
 #include <shared_mutex>
 
-class ParallelBplustree {
+template <typename Traits>
+class BasicParallelBplustree {
+	typedef BasicBplustree<Traits> Bplustree;
+
 	public:
-		ParallelBplustree(const int order, const int numThreads, const int numTrees, const bool useBloomFilters);
-		~ParallelBplustree();
-		void insert(const int key, const int value);
-		void insert(std::vector<int> &keys, std::vector<int> &values);
-		void update(const int key, const std::vector<int> &values);
-		void update(std::vector<int> &keys, std::vector<std::vector<int>> &values);
-		std::future<std::vector<std::future<const std::vector<int> *>>> search(const int key);
-		std::vector<std::vector<const std::vector<int> *>> search(const std::vector<int> &keys);
-		std::future<std::vector<std::future<bool>>> remove(const int key);
-		void remove(std::vector<int> &keys);
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Value Value;
+		typedef typename Bplustree::ValueSlot ValueSlot;
+		typedef typename Bplustree::Aggregate Aggregate;
+		BasicParallelBplustree(const int order, const int numThreads, const int numTrees, const bool useBloomFilters, const bool useHugePages = false);
+		~BasicParallelBplustree();
+		void insert(const Key &key, const Value value);
+		void insert(std::vector<Key> &keys, std::vector<Value> &values);
+		void update(const Key &key, const std::vector<Value> &values);
+		void update(std::vector<Key> &keys, std::vector<std::vector<Value>> &values);
+		std::future<std::vector<std::future<const ValueSlot *>>> search(const Key &key);
+		std::vector<std::vector<const ValueSlot *>> search(const std::vector<Key> &keys);
+		std::future<std::vector<std::future<bool>>> remove(const Key &key);
+		void remove(std::vector<Key> &keys);
+		long long removeRange(const Key &start, const Key &end);
+		void setRelaxedRemoves(const bool relaxed, const double compactionThreshold = 0.25);
+		void setPartitioner(const Partitioner<Traits> *partitioner);
+		const Partitioner<Traits> *getPartitioner() const;
+		void setSharedNothing(const bool enabled);
+		bool isSharedNothing() const;
+		void freeze();
+		void thaw();
+		bool isFrozen() const;
+		void setSubtreeCounts(const bool enabled);
+		long long rank(const Key &key);
+		long long countRange(const Key &start, const Key &end);
+		Aggregate aggregate(const Key &start, const Key &end);
 
 		void show();
 		void waitForWorkToFinish();
 		std::vector<int> getTreeNumKeys();
+		std::vector<TreeStats> getTreeStats();
 		int getOrder();
 		int getNumThreads();
 		int getNumTrees();
@@ -31,22 +55,53 @@ class ParallelBplustree {
 		const int numThreads;
 		const int numTrees;
 		const bool useBloomFilters;
+		bool relaxedRemoves;
+		// Deferred removes, as a fraction of the leaves of a tree, that trigger its compaction.
+		double compactionThreshold;
+		bool subtreeCounts;
+		// Owned, gives the tree of each key; keys are placed at random and looked up in all trees without it.
+		const Partitioner<Traits> *partitioner;
+		// Owned, set in shared-nothing mode; the owner of a tree then runs all operations on it, without its lock.
+		PartitionWorkers *partitionWorkers;
+		// Set while all trees are frozen; reads then take no tree or filter locks.
+		std::atomic<bool> frozen;
 		std::vector<Bplustree *> trees;
 		std::vector<std::shared_mutex *> treeLocks;
 		std::vector<bloom_filter *> treeFilters;
 		std::vector<std::shared_mutex *> treeFilterLocks;
+		std::vector<std::atomic<bool>> compactionScheduled;
 		thread_pool threadPool;
-		void threadInsert(const int key, const int value);
-		void threadInsert(std::vector<int>::iterator keysSplitBegin, std::vector<int>::iterator keysSplitEnd, std::vector<int>::iterator valuesSplitBegin, const int treeIndex = -1);
-		const std::vector<int> *threadSearch(const int key, const int treeIndex) const;
-		void threadSearch(const std::vector<int> *batchKeys, const int treeIndex, std::vector<std::vector<const std::vector<int> *>> &result, const std::vector<int> keysPos);
-		void threadSearchCoordinator(const int key, std::promise<std::vector<std::future<const std::vector<int> *>>> *prom);
-		bool threadUpdate(const int key, const std::vector<int> &values, const int treeIndex);
-		void threadUpdateThenDelete(std::vector<int> updateKeys, std::vector<int> updateIndexOfValues, const std::vector<std::vector<int>> *updateBatchValues, std::vector<int> deleteKeys, const int treeIndex);
-		void threadUpdateCoordinator(const int key, const std::vector<int> &values);
-		bool threadRemove(const int key, const int treeIndex);
-		void threadRemove(std::vector<int> keys, const int treeIndex);
-		void threadRemove(std::vector<int> *keys, const int treeIndex);
-		void threadRemoveCoordinator(const int key, std::promise<std::vector<std::future<bool>>> *prom);
+		void threadInsert(const Key &key, const Value value);
+		void threadInsert(typename std::vector<Key>::iterator keysSplitBegin, typename std::vector<Key>::iterator keysSplitEnd, typename std::vector<Value>::iterator valuesSplitBegin, const int treeIndex = -1);
+		const ValueSlot *threadSearch(const Key &key, const int treeIndex) const;
+		void threadSearch(const std::vector<Key> *batchKeys, const int treeIndex, std::vector<std::vector<const ValueSlot *>> &result, const std::vector<int> keysPos);
+		void threadSearchCoordinator(const Key &key, std::promise<std::vector<std::future<const ValueSlot *>>> *prom);
+		bool threadUpdate(const Key &key, const std::vector<Value> &values, const int treeIndex);
+		void threadUpdateThenDelete(std::vector<Key> updateKeys, std::vector<int> updateIndexOfValues, const std::vector<std::vector<Value>> *updateBatchValues, std::vector<Key> deleteKeys, const int treeIndex);
+		void threadUpdateCoordinator(const Key &key, const std::vector<Value> &values);
+		bool threadRemove(const Key &key, const int treeIndex);
+		void threadRemove(std::vector<Key> keys, const int treeIndex);
+		void threadRemove(std::vector<Key> *keys, const int treeIndex);
+		void threadRemoveCoordinator(const Key &key, std::promise<std::vector<std::future<bool>>> *prom);
+		void scheduleCompaction(const int treeIndex);
+		void threadCompact(const int treeIndex);
+		void throwIfFrozen() const;
+		int getOwner(const Key &key) const;
+		std::unique_lock<std::shared_mutex> lockTree(const int treeIndex);
+		template <typename Task>
+		void pushTreeTask(const int treeIndex, const Task &task);
+		template <typename Query>
+		void queryTrees(const Query &query);
+		template <typename Modify>
+		void modifyTrees(const Modify &modify);
+		template <typename Count>
+		long long sumTreeCounts(const Count &count);
 };
 
+typedef BasicParallelBplustree<BplustreeTraits<>> ParallelBplustree;
+
+template <int LeafOrder, int InternalOrder = LeafOrder>
+using FixedParallelBplustree = BasicParallelBplustree<BplustreeTraits<LeafOrder, InternalOrder>>;
+
+template <typename Key>
+using KeyParallelBplustree = BasicParallelBplustree<KeyTraits<Key>>;
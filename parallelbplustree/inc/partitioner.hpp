@@ -0,0 +1,53 @@
+#ifndef PARTITIONER_HPP
+#define PARTITIONER_HPP
+
+#include "bplustreetraits.hpp"
+#include <vector>
+
+/*
+Maps every key to the one tree of a ParallelBplustree that holds it, so
+that point operations go to a single tree instead of all of them.
+*/
+template <typename Traits>
+class Partitioner {
+	public:
+		typedef typename Traits::Key Key;
+		virtual ~Partitioner() {}
+		virtual int getPartition(const Key &key) const = 0;
+		int getNumPartitions() const { return numPartitions; }
+
+	protected:
+		Partitioner(const int numPartitions);
+		const int numPartitions;
+};
+
+/*
+Spreads keys evenly by a hash of their bytes, whatever the key order.
+*/
+template <typename Traits>
+class HashPartitioner : public Partitioner<Traits> {
+	public:
+		typedef typename Traits::Key Key;
+		HashPartitioner(const int numPartitions);
+		int getPartition(const Key &key) const override;
+};
+
+/*
+Splits the key space into contiguous ranges holding about as many keys
+each, going by the quantiles of a sample of the keys. A key equal to a
+boundary belongs to the range right of it.
+*/
+template <typename Traits>
+class RangePartitioner : public Partitioner<Traits> {
+	public:
+		typedef typename Traits::Key Key;
+		typedef typename Traits::Compare Compare;
+		RangePartitioner(const int numPartitions, std::vector<Key> sample);
+		int getPartition(const Key &key) const override;
+		const std::vector<Key> &getBoundaries() const;
+
+	private:
+		std::vector<Key> boundaries;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PARTITIONWORKERS_HPP
+#define PARTITIONWORKERS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+One worker thread per partition, pinned to a core, running the tasks
+pushed to the inbox of its partition in order. As no other thread runs
+tasks of the partition, they may use its data without locking it.
+*/
+class PartitionWorkers {
+	public:
+		PartitionWorkers(const int numPartitions);
+		~PartitionWorkers();
+		void push(const int partition, std::function<void()> task);
+		void wait();
+		int getNumPartitions() const;
+
+	private:
+		struct Inbox {
+			std::mutex mutex;
+			std::condition_variable ready;
+			std::vector<std::function<void()>> tasks;
+			bool stopping = false;
+		};
+		const int numPartitions;
+		std::vector<Inbox *> inboxes;
+		std::vector<std::thread> workers;
+		// Tasks pushed and not yet run, over all inboxes.
+		std::atomic<long long> pending;
+		std::mutex idleMutex;
+		std::condition_variable idle;
+		void work(const int partition);
+};
+
+#endif
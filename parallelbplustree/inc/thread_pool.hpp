@@ -15,28 +15,34 @@
 #define THREAD_POOL_VERSION "v2.0.0 (2021-08-14)"
 
 #include <atomic>      // std::atomic
+#include <algorithm>   // std::max, std::min
 #include <chrono>      // std::chrono
+#include <condition_variable> // std::condition_variable
+#include <cstddef>     // std::max_align_t, std::size_t
 #include <cstdint>     // std::int_fast64_t, std::uint_fast32_t
-#include <functional>  // std::function
 #include <future>      // std::future, std::promise
 #include <iostream>    // std::cout, std::ostream
-#include <memory>      // std::shared_ptr, std::unique_ptr
+#include <iterator>    // std::make_move_iterator
+#include <memory>      // std::unique_ptr
+#include <new>         // std::launder
 #include <mutex>       // std::mutex, std::scoped_lock
-#include <queue>       // std::queue
 #include <thread>      // std::this_thread, std::thread
 #include <type_traits> // std::common_type_t, std::decay_t, std::enable_if_t, std::is_void_v, std::invoke_result_t
 #include <utility>     // std::move
+#include <vector>      // std::vector
 
 // ============================================================================================= //
 //                                    Begin class thread_pool                                    //
 
 /**
  * @brief A C++17 thread pool class. The user submits tasks to be executed into a queue. Whenever a thread becomes available, it pops a task from the queue and executes it. Each task is automatically assigned a future, which can be used to wait for the task to finish executing and/or obtain its eventual return value.
+ * @details Tasks are scheduled by work stealing. Each worker owns a Chase-Lev deque, to which the tasks it submits itself are pushed, and which it pops from the bottom, most recent task first. Tasks submitted from other threads are pushed to a lock-free injection stack, which an idle worker takes as a whole into its deque, oldest task at the bottom. Workers with nothing left of their own steal the oldest tasks from the tops of the deques of others. No lock is taken to push or pop a task.
  */
 class thread_pool
 {
     typedef std::uint_fast32_t ui32;
     typedef std::uint_fast64_t ui64;
+    typedef std::int_fast64_t i64;
 
 public:
     // ============================
@@ -49,7 +55,7 @@ public:
      * @param _thread_count The number of threads to use. The default value is the total number of hardware threads available, as reported by the implementation. With a hyperthreaded CPU, this will be twice the number of CPU cores. If the argument is zero, the default value will be used instead.
      */
     thread_pool(const ui32 &_thread_count = std::thread::hardware_concurrency())
-        : thread_count(_thread_count ? _thread_count : std::thread::hardware_concurrency()), threads(new std::thread[_thread_count ? _thread_count : std::thread::hardware_concurrency()])
+        : thread_count(_thread_count ? _thread_count : std::thread::hardware_concurrency()), threads(new std::thread[thread_count]), deques(new task_deque[thread_count])
     {
         create_threads();
     }
@@ -62,6 +68,13 @@ public:
         wait_for_tasks();
         running = false;
         destroy_threads();
+        for (task_node *task = take_queued_tasks(); task;)
+        {
+            task_node *next = task->next;
+            task->execute(task->storage, false);
+            task_freelist::release(task);
+            task = next;
+        }
     }
 
     // =======================
@@ -75,8 +88,7 @@ public:
      */
     ui64 get_tasks_queued() const
     {
-        const std::scoped_lock lock(queue_mutex);
-        return tasks.size();
+        return tasks_queued;
     }
 
     /**
@@ -144,50 +156,75 @@ public:
             block_size = 1;
             num_blocks = (ui32)total_size > 1 ? (ui32)total_size : 1;
         }
-        std::atomic<ui32> blocks_running = 0;
+        // The last block notifies while holding the mutex, so that the waiting thread cannot return and destroy it first.
+        std::mutex blocks_mutex;
+        std::condition_variable blocks_done;
+        ui32 blocks_running = num_blocks;
+        task_node *newest = nullptr;
+        task_node *oldest = nullptr;
         for (ui32 t = 0; t < num_blocks; t++)
         {
             T start = ((T)(t * block_size) + the_first_index);
             T end = (t == num_blocks - 1) ? last_index + 1 : ((T)((t + 1) * block_size) + the_first_index);
-            blocks_running++;
-            push_task([start, end, &loop, &blocks_running]
+            link_task(newest, oldest, [start, end, &loop, &blocks_mutex, &blocks_done, &blocks_running]
                       {
                           loop(start, end);
-                          blocks_running--;
+                          const std::scoped_lock lock(blocks_mutex);
+                          if (--blocks_running == 0)
+                              blocks_done.notify_all();
                       });
         }
-        while (blocks_running != 0)
-        {
-            sleep_or_yield();
-        }
+        enqueue(newest, oldest, num_blocks);
+        std::unique_lock<std::mutex> lock(blocks_mutex);
+        blocks_done.wait(lock, [&blocks_running]
+                         { return blocks_running == 0; });
     }
 
     /**
      * @brief Push a function with no arguments or return value into the task queue.
+     * @details The function is stored in a recycled task node, inline if it fits, so that pushing it allocates nothing once the pool has warmed up. The function may be move-only.
      *
      * @tparam F The type of the function.
      * @param task The function to push.
      */
     template <typename F>
-    void push_task(const F &task)
+    void push_task(F &&task)
     {
-        tasks_total++;
-        {
-            const std::scoped_lock lock(queue_mutex);
-            tasks.push(std::function<void()>(task));
-        }
+        task_node *newest = nullptr;
+        task_node *oldest = nullptr;
+        link_task(newest, oldest, std::forward<F>(task));
+        enqueue(newest, oldest, 1);
+    }
+
+    /**
+     * @brief Push a range of functions with no arguments or return value into the task queue at once. The task counters are updated once for the whole range, and pushed from outside the pool, the range takes a single compare-and-swap on the injection stack.
+     *
+     * @tparam I The type of the iterators. Each function is copied out of the range, or moved if the iterators are move iterators.
+     * @param first An iterator to the first function.
+     * @param last An iterator past the last function.
+     */
+    template <typename I>
+    void push_tasks(I first, I last)
+    {
+        task_node *newest = nullptr;
+        task_node *oldest = nullptr;
+        ui32 count = 0;
+        for (; first != last; ++first, count++)
+            link_task(newest, oldest, *first);
+        if (count > 0)
+            enqueue(newest, oldest, count);
     }
 
     /**
      * @brief Push a function with arguments, but no return value, into the task queue.
-     * @details The function is wrapped inside a lambda in order to hide the arguments, as the tasks in the queue must be of type std::function<void()>, so they cannot have any arguments or return value. If no arguments are provided, the other overload will be used, in order to avoid the (slight) overhead of using a lambda.
+     * @details The function is wrapped inside a lambda in order to hide the arguments, as the tasks in the queue are called with no arguments and their return value is ignored. If no arguments are provided, the other overload will be used, in order to avoid the (slight) overhead of using a lambda.
      *
      * @tparam F The type of the function.
      * @tparam A The types of the arguments.
      * @param task The function to push.
      * @param args The arguments to pass to the function.
      */
-    template <typename F, typename... A>
+    template <typename F, typename... A, typename = std::enable_if_t<(sizeof...(A) > 0)>>
     void push_task(const F &task, const A &...args)
     {
         push_task([task, args...]
@@ -206,8 +243,17 @@ public:
         wait_for_tasks();
         running = false;
         destroy_threads();
+        task_node *queued = take_queued_tasks();
         thread_count = _thread_count ? _thread_count : std::thread::hardware_concurrency();
         threads.reset(new std::thread[thread_count]);
+        deques.reset(new task_deque[thread_count]);
+        if (queued)
+        {
+            task_node *last = queued;
+            while (last->next)
+                last = last->next;
+            inject(queued, last);
+        }
         paused = was_paused;
         running = true;
         create_threads();
@@ -225,20 +271,20 @@ public:
     template <typename F, typename... A, typename = std::enable_if_t<std::is_void_v<std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>>>>
     std::future<bool> submit(const F &task, const A &...args)
     {
-        std::shared_ptr<std::promise<bool>> task_promise(new std::promise<bool>);
-        std::future<bool> future = task_promise->get_future();
-        push_task([task, args..., task_promise]
+        std::promise<bool> task_promise;
+        std::future<bool> future = task_promise.get_future();
+        push_task([task, args..., task_promise = std::move(task_promise)]() mutable
                   {
                       try
                       {
                           task(args...);
-                          task_promise->set_value(true);
+                          task_promise.set_value(true);
                       }
                       catch (...)
                       {
                           try
                           {
-                              task_promise->set_exception(std::current_exception());
+                              task_promise.set_exception(std::current_exception());
                           }
                           catch (...)
                           {
@@ -261,19 +307,19 @@ public:
     template <typename F, typename... A, typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>, typename = std::enable_if_t<!std::is_void_v<R>>>
     std::future<R> submit(const F &task, const A &...args)
     {
-        std::shared_ptr<std::promise<R>> task_promise(new std::promise<R>);
-        std::future<R> future = task_promise->get_future();
-        push_task([task, args..., task_promise]
+        std::promise<R> task_promise;
+        std::future<R> future = task_promise.get_future();
+        push_task([task, args..., task_promise = std::move(task_promise)]() mutable
                   {
                       try
                       {
-                          task_promise->set_value(task(args...));
+                          task_promise.set_value(task(args...));
                       }
                       catch (...)
                       {
                           try
                           {
-                              task_promise->set_exception(std::current_exception());
+                              task_promise.set_exception(std::current_exception());
                           }
                           catch (...)
                           {
@@ -285,22 +331,21 @@ public:
 
     /**
      * @brief Wait for tasks to be completed. Normally, this function waits for all tasks, both those that are currently running in the threads and those that are still waiting in the queue. However, if the variable paused is set to true, this function only waits for the currently running tasks (otherwise it would wait forever). To wait for a specific task, use submit() instead, and call the wait() member function of the generated future.
+     * @details The calling thread blocks until the worker finishing the last task, or while paused any task, notifies it. As setting paused notifies no one, the pool may be paused with no task left running to do so, so the calling thread also wakes up every sleep_duration microseconds to check whether only queued tasks remain.
      */
     void wait_for_tasks()
     {
-        while (true)
+        std::unique_lock<std::mutex> tasks_done_lock(tasks_done_mutex);
+        while (paused ? tasks_total != get_tasks_queued() : tasks_total != 0)
         {
-            if (!paused)
-            {
-                if (tasks_total == 0)
-                    break;
-            }
+            if (sleep_duration)
+                tasks_done.wait_for(tasks_done_lock, std::chrono::microseconds(sleep_duration));
             else
             {
-                if (get_tasks_running() == 0)
-                    break;
+                tasks_done_lock.unlock();
+                std::this_thread::yield();
+                tasks_done_lock.lock();
             }
-            sleep_or_yield();
         }
     }
 
@@ -314,11 +359,269 @@ public:
     std::atomic<bool> paused = false;
 
     /**
-     * @brief The duration, in microseconds, that the worker function should sleep for when it cannot find any tasks in the queue. If set to 0, then instead of sleeping, the worker function will execute std::this_thread::yield() if there are no tasks in the queue. The default value is 1000.
+     * @brief The duration, in microseconds, that the worker function should sleep for while the pool is paused. If set to 0, then instead of sleeping, the worker function will execute std::this_thread::yield(). It is also the interval at which wait_for_tasks() checks whether the pool has been paused. The default value is 1000. Unpaused workers that find no tasks spin for a while, then block until a task is submitted.
      */
     ui32 sleep_duration = 1000;
 
 private:
+    // =============
+    // Private types
+    // =============
+
+    /**
+     * @brief A task waiting in the pool. Tasks on the injection stack, in a freelist or on their way into the pool are linked by next.
+     */
+    struct task_node
+    {
+        /**
+         * @brief The size of the inline storage for the function, enough for the captures of the tasks ParallelBplustree pushes, and small enough for a node to take two cache lines. A larger function is moved to the heap and a pointer to it is kept inline.
+         */
+        static constexpr std::size_t inline_size = 96;
+
+        alignas(std::max_align_t) unsigned char storage[inline_size];
+
+        /**
+         * @brief Runs the function in storage if run is true, then destroys it.
+         */
+        void (*execute)(void *storage, bool run) = nullptr;
+
+        task_node *next = nullptr;
+    };
+
+    /**
+     * @brief Recycles task nodes. Each thread keeps the nodes it frees in a list of its own, and reuses them for the tasks it pushes. As nodes are mostly freed by the workers but allocated by the threads pushing tasks, a thread holding two batches of free nodes hands one to a global pool, from which a thread with no free nodes left takes a batch, each under a mutex taken once per batch. Nodes beyond what the global pool holds are deleted.
+     */
+    class task_freelist
+    {
+    public:
+        /**
+         * @brief Take a free node, or allocate one if there is none.
+         */
+        static task_node *allocate()
+        {
+            local_list &local = this_thread_list();
+            if (!local.head)
+            {
+                global_pool &global = this_global_pool();
+                const std::scoped_lock lock(global.mutex);
+                if (!global.batches.empty())
+                {
+                    local.head = global.batches.back();
+                    local.size = batch_size;
+                    global.batches.pop_back();
+                }
+            }
+            task_node *node = local.head;
+            if (!node)
+                return new task_node;
+            local.head = node->next;
+            local.size--;
+            node->next = nullptr;
+            return node;
+        }
+
+        /**
+         * @brief Return a node whose function has been destroyed.
+         */
+        static void release(task_node *node)
+        {
+            local_list &local = this_thread_list();
+            node->next = local.head;
+            local.head = node;
+            if (++local.size < 2 * batch_size)
+                return;
+            task_node *batch = local.head;
+            task_node *batch_last = batch;
+            for (ui32 i = 1; i < batch_size; i++)
+                batch_last = batch_last->next;
+            local.head = batch_last->next;
+            local.size -= batch_size;
+            batch_last->next = nullptr;
+            global_pool &global = this_global_pool();
+            {
+                const std::scoped_lock lock(global.mutex);
+                if (global.batches.size() < max_batches)
+                {
+                    global.batches.push_back(batch);
+                    return;
+                }
+            }
+            delete_list(batch);
+        }
+
+    private:
+        static constexpr ui32 batch_size = 64;
+        static constexpr std::size_t max_batches = 1024;
+
+        struct local_list
+        {
+            ~local_list()
+            {
+                delete_list(head);
+            }
+
+            task_node *head = nullptr;
+            ui32 size = 0;
+        };
+
+        struct global_pool
+        {
+            global_pool()
+            {
+                batches.reserve(max_batches);
+            }
+
+            ~global_pool()
+            {
+                for (task_node *batch : batches)
+                    delete_list(batch);
+            }
+
+            std::mutex mutex;
+            std::vector<task_node *> batches;
+        };
+
+        static void delete_list(task_node *node)
+        {
+            while (node)
+            {
+                task_node *next = node->next;
+                delete node;
+                node = next;
+            }
+        }
+
+        static local_list &this_thread_list()
+        {
+            static thread_local local_list list;
+            return list;
+        }
+
+        static global_pool &this_global_pool()
+        {
+            static global_pool pool;
+            return pool;
+        }
+    };
+
+    /**
+     * @brief The pool and index of a worker, as known to its thread.
+     */
+    struct worker_identity
+    {
+        const thread_pool *pool = nullptr;
+        ui32 index = 0;
+    };
+
+    /**
+     * @brief A power of two sized ring of task slots, indexed modulo its capacity.
+     */
+    struct task_ring
+    {
+        explicit task_ring(const i64 _capacity)
+            : capacity(_capacity), slots(new std::atomic<task_node *>[_capacity]) {}
+
+        task_node *get(const i64 i) const
+        {
+            return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(const i64 i, task_node *task)
+        {
+            slots[i & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+
+        const i64 capacity;
+        std::unique_ptr<std::atomic<task_node *>[]> slots;
+    };
+
+    /**
+     * @brief A Chase-Lev work-stealing deque. Only the worker owning it pushes and pops, at the bottom; other workers steal from the top. When full, the tasks are copied to a ring of twice the size. Outgrown rings are kept until the deque is destroyed, as a thief may still be reading from one.
+     */
+    class task_deque
+    {
+    public:
+        task_deque()
+        {
+            rings.emplace_back(new task_ring(64));
+            ring = rings.back().get();
+        }
+
+        /**
+         * @brief Push a task at the bottom. Only called by the owner.
+         */
+        void push(task_node *task)
+        {
+            const i64 b = bottom.load(std::memory_order_relaxed);
+            const i64 t = top.load(std::memory_order_acquire);
+            task_ring *r = ring.load(std::memory_order_relaxed);
+            if (b - t >= r->capacity)
+                r = grow(r, t, b);
+            r->put(b, task);
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Pop the task at the bottom. Only called by the owner. When a single task is left, the owner races the thieves for it on top.
+         *
+         * @return The task, or nullptr if the deque was empty or a thief took the last task.
+         */
+        task_node *pop()
+        {
+            const i64 b = bottom.load(std::memory_order_relaxed) - 1;
+            task_ring *r = ring.load(std::memory_order_relaxed);
+            // Sequentially consistent, so that a thief reading top after this sees the lowered bottom.
+            bottom.store(b, std::memory_order_seq_cst);
+            i64 t = top.load(std::memory_order_seq_cst);
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            task_node *task = r->get(b);
+            if (t == b)
+            {
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    task = nullptr;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        /**
+         * @brief Steal the task at the top. Called by any worker but the owner.
+         *
+         * @return The task, or nullptr if the deque was empty or another thread took the task first.
+         */
+        task_node *steal()
+        {
+            i64 t = top.load(std::memory_order_seq_cst);
+            const i64 b = bottom.load(std::memory_order_seq_cst);
+            if (t >= b)
+                return nullptr;
+            task_node *task = ring.load(std::memory_order_acquire)->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return task;
+        }
+
+    private:
+        task_ring *grow(task_ring *old, const i64 t, const i64 b)
+        {
+            task_ring *larger = new task_ring(old->capacity * 2);
+            for (i64 i = t; i < b; i++)
+                larger->put(i, old->get(i));
+            rings.emplace_back(larger);
+            ring.store(larger, std::memory_order_release);
+            return larger;
+        }
+
+        alignas(64) std::atomic<i64> top = 0;
+        alignas(64) std::atomic<i64> bottom = 0;
+        std::atomic<task_ring *> ring = nullptr;
+        std::vector<std::unique_ptr<task_ring>> rings;
+    };
+
     // ========================
     // Private member functions
     // ========================
@@ -330,7 +633,7 @@ private:
     {
         for (ui32 i = 0; i < thread_count; i++)
         {
-            threads[i] = std::thread(&thread_pool::worker, this);
+            threads[i] = std::thread(&thread_pool::worker, this, i);
         }
     }
 
@@ -339,6 +642,8 @@ private:
      */
     void destroy_threads()
     {
+        wake_epoch++;
+        wake_epoch.notify_all();
         for (ui32 i = 0; i < thread_count; i++)
         {
             threads[i].join();
@@ -346,24 +651,151 @@ private:
     }
 
     /**
-     * @brief Try to pop a new task out of the queue.
+     * @brief Store a function in a free node, linked in front of a chain of tasks that are about to be enqueued.
      *
-     * @param task A reference to the task. Will be populated with a function if the queue is not empty.
-     * @return true if a task was found, false if the queue is empty.
+     * @tparam F The type of the function.
+     * @param newest The most recent task of the chain, replaced by the new one.
+     * @param oldest The least recent task of the chain, set to the new one if the chain was empty.
+     * @param task The function to store.
      */
-    bool pop_task(std::function<void()> &task)
+    template <typename F>
+    static void link_task(task_node *&newest, task_node *&oldest, F &&task)
     {
-        const std::scoped_lock lock(queue_mutex);
-        if (tasks.empty())
-            return false;
+        typedef std::decay_t<F> T;
+        task_node *node = task_freelist::allocate();
+        if constexpr (sizeof(T) <= task_node::inline_size && alignof(T) <= alignof(std::max_align_t))
+        {
+            new (node->storage) T(std::forward<F>(task));
+            node->execute = [](void *storage, const bool run)
+            {
+                T &function = *std::launder(reinterpret_cast<T *>(storage));
+                if (run)
+                    function();
+                function.~T();
+            };
+        }
         else
         {
-            task = std::move(tasks.front());
-            tasks.pop();
-            return true;
+            new (node->storage) T *(new T(std::forward<F>(task)));
+            node->execute = [](void *storage, const bool run)
+            {
+                T *function = *std::launder(reinterpret_cast<T **>(storage));
+                if (run)
+                    (*function)();
+                delete function;
+            };
+        }
+        node->next = newest;
+        newest = node;
+        if (!oldest)
+            oldest = node;
+    }
+
+    /**
+     * @brief Enqueue a chain of tasks built by link_task: to the deque of the calling worker if it is one of this pool, else onto the injection stack. Counts the tasks before they can be taken, and wakes parked workers for them.
+     *
+     * @param newest The most recent task of the chain.
+     * @param oldest The least recent task of the chain.
+     * @param count The number of tasks in the chain.
+     */
+    void enqueue(task_node *newest, task_node *oldest, const ui32 count)
+    {
+        tasks_total += count;
+        tasks_queued += count;
+        const worker_identity &self = this_worker();
+        if (self.pool == this)
+        {
+            for (task_node *task = newest; task;)
+            {
+                task_node *next = task->next;
+                deques[self.index].push(task);
+                task = next;
+            }
+        }
+        else
+            inject(newest, oldest);
+        wake_workers(count);
+    }
+
+    /**
+     * @brief Push a chain of tasks, linked from first to last, onto the injection stack, from which any worker may take them.
+     *
+     * @param first The most recently submitted task of the chain.
+     * @param last The least recently submitted task of the chain.
+     */
+    void inject(task_node *first, task_node *last)
+    {
+        last->next = injected.load(std::memory_order_relaxed);
+        while (!injected.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed))
+        {
         }
     }
 
+    /**
+     * @brief Try to find a task for a worker to execute: the most recent task in its own deque, else the oldest task of the injection stack, after moving the rest of the stack into its deque, else the oldest task in the deque of another worker.
+     *
+     * @param index The index of the worker.
+     * @param next_victim The worker to try to steal from first. Advanced past the workers tried.
+     * @return The task found, or nullptr if there was none.
+     */
+    task_node *pop_task(const ui32 index, ui32 &next_victim)
+    {
+        task_deque &own = deques[index];
+        if (task_node *task = own.pop())
+            return task;
+        if (task_node *task = injected.exchange(nullptr, std::memory_order_acquire))
+        {
+            // The stack holds the most recent task first, so pushing it in order leaves the oldest ones at the bottom of the deque, to be popped first.
+            while (task->next)
+            {
+                task_node *next = task->next;
+                own.push(task);
+                task = next;
+            }
+            return task;
+        }
+        for (ui32 i = 0; i < thread_count; i++)
+        {
+            const ui32 victim = next_victim;
+            next_victim = next_victim + 1 < thread_count ? next_victim + 1 : 0;
+            if (victim == index)
+                continue;
+            if (task_node *task = deques[victim].steal())
+                return task;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Take all tasks still queued, in the deques and the injection stack, once the threads have been destroyed.
+     *
+     * @return The tasks, linked from the most recently submitted one. The order of tasks taken from different deques is not preserved.
+     */
+    task_node *take_queued_tasks()
+    {
+        task_node *queued = injected.exchange(nullptr);
+        for (ui32 i = 0; i < thread_count; i++)
+        {
+            // Popping at the bottom takes the most recent task of a deque first.
+            task_node *last = nullptr;
+            task_node *first = nullptr;
+            while (task_node *task = deques[i].pop())
+            {
+                if (last)
+                    last->next = task;
+                else
+                    first = task;
+                last = task;
+            }
+            if (last)
+            {
+                last->next = queued;
+                queued = first;
+            }
+        }
+        return queued;
+    }
+
     /**
      * @brief Sleep for sleep_duration microseconds. If that variable is set to zero, yield instead.
      *
@@ -379,31 +811,92 @@ private:
     /**
      * @brief A worker function to be assigned to each thread in the pool. Continuously pops tasks out of the queue and executes them, as long as the atomic variable running is set to true.
      */
-    void worker()
+    void worker(const ui32 index)
     {
+        this_worker() = {this, index};
+        ui32 next_victim = index + 1 < thread_count ? index + 1 : 0;
+        ui32 spin_limit = max_spins;
+        ui32 spins = 0;
         while (running)
         {
-            std::function<void()> task;
-            if (!paused && pop_task(task))
+            if (paused)
+            {
+                sleep_or_yield();
+            }
+            else if (task_node *task = pop_task(index, next_victim))
+            {
+                // Spinning paid off, so spin longer next time.
+                if (spins > 0)
+                    spin_limit = std::min(spin_limit * 2, max_spins);
+                spins = 0;
+                tasks_queued--;
+                task->execute(task->storage, true);
+                task_freelist::release(task);
+                if (tasks_total.fetch_sub(1) == 1 || paused)
+                {
+                    const std::scoped_lock tasks_done_lock(tasks_done_mutex);
+                    tasks_done.notify_all();
+                }
+            }
+            else if (spins < spin_limit)
             {
-                task();
-                tasks_total--;
+                spins++;
+                std::this_thread::yield();
             }
             else
             {
-                sleep_or_yield();
+                park();
+                spin_limit = std::max(spin_limit / 2, min_spins);
+                spins = 0;
             }
         }
+        this_worker() = {};
     }
 
-    // ============
-    // Private data
-    // ============
+    /**
+     * @brief Block the calling worker until a task is submitted or the pool stops running.
+     * @details A worker announces itself in sleeping before it checks for queued tasks, while enqueue counts its tasks in tasks_queued before it checks for sleeping workers. As all four accesses are sequentially consistent, either the worker sees the task or enqueue sees the worker and wakes it.
+     */
+    void park()
+    {
+        sleeping++;
+        const std::uint32_t epoch = wake_epoch;
+        if (running && !paused && tasks_queued == 0)
+            wake_epoch.wait(epoch);
+        sleeping--;
+    }
 
     /**
-     * @brief A mutex to synchronize access to the task queue by different threads.
+     * @brief Wake parked workers, if there are any, for tasks just submitted: one for a single task, all of them for more.
+     *
+     * @param count The number of tasks submitted.
      */
-    mutable std::mutex queue_mutex = {};
+    void wake_workers(const ui32 count)
+    {
+        if (sleeping > 0)
+        {
+            wake_epoch++;
+            if (count > 1)
+                wake_epoch.notify_all();
+            else
+                wake_epoch.notify_one();
+        }
+    }
+
+    /**
+     * @brief Get the pool and index of the worker running on the calling thread.
+     *
+     * @return The identity of the worker, with a null pool if the calling thread is not a worker.
+     */
+    static worker_identity &this_worker()
+    {
+        static thread_local worker_identity identity;
+        return identity;
+    }
+
+    // ============
+    // Private data
+    // ============
 
     /**
      * @brief An atomic variable indicating to the workers to keep running. When set to false, the workers permanently stop working.
@@ -411,9 +904,9 @@ private:
     std::atomic<bool> running = true;
 
     /**
-     * @brief A queue of tasks to be executed by the threads.
+     * @brief The injection stack, holding the tasks submitted from outside the pool that no worker has taken yet, most recent first.
      */
-    std::queue<std::function<void()>> tasks = {};
+    std::atomic<task_node *> injected = nullptr;
 
     /**
      * @brief The number of threads in the pool.
@@ -425,10 +918,42 @@ private:
      */
     std::unique_ptr<std::thread[]> threads;
 
+    /**
+     * @brief The deque of each worker.
+     */
+    std::unique_ptr<task_deque[]> deques;
+
     /**
      * @brief An atomic variable to keep track of the total number of unfinished tasks - either still in the queue, or running in a thread.
      */
     std::atomic<ui32> tasks_total = 0;
+
+    /**
+     * @brief An atomic variable to keep track of the number of tasks submitted that no worker has started executing yet.
+     */
+    std::atomic<ui32> tasks_queued = 0;
+
+    /**
+     * @brief A mutex and condition variable through which a worker finishing the last task, or any task while the pool is paused, wakes threads in wait_for_tasks().
+     */
+    std::mutex tasks_done_mutex;
+    std::condition_variable tasks_done;
+
+    /**
+     * @brief The number of workers parked, or about to park, waiting for tasks.
+     */
+    std::atomic<ui32> sleeping = 0;
+
+    /**
+     * @brief Advanced to wake parked workers, which wait for it to change.
+     */
+    std::atomic<std::uint32_t> wake_epoch = 0;
+
+    /**
+     * @brief The bounds on the number of times an idle worker looks for tasks again, yielding in between, before it parks. Each worker adapts its own limit within them, doubling it when spinning finds a task and halving it when the worker has to park.
+     */
+    static constexpr ui32 min_spins = 16;
+    static constexpr ui32 max_spins = 1024;
 };
 
 //                                     End class thread_pool                                     //
@@ -1,19 +1,29 @@
 #include "parallelbplustree.hpp"
+#include <map>
 #include <random>
 
-ParallelBplustree::ParallelBplustree(
+template <typename Traits>
+BasicParallelBplustree<Traits>::BasicParallelBplustree(
 		const int order,
 		const int numThreads,
 		const int numTrees,
-		const bool useBloomFilters
+		const bool useBloomFilters,
+		const bool useHugePages
 		) :
 	order(order),
 	numThreads(numThreads),
 	threadPool(numThreads),
 	numTrees(numTrees),
-	useBloomFilters(useBloomFilters) {
+	useBloomFilters(useBloomFilters),
+	relaxedRemoves(false),
+	compactionThreshold(0),
+	subtreeCounts(false),
+	partitioner(nullptr),
+	partitionWorkers(nullptr),
+	frozen(false),
+	compactionScheduled(numTrees) {
 		for (int i = 0; i < numTrees; i++) {
-			trees.push_back(new Bplustree(order));
+			trees.push_back(new Bplustree(order, useHugePages));
 			treeLocks.push_back(new std::shared_mutex);
 			treeFilterLocks.push_back(new std::shared_mutex);
 		}
@@ -28,10 +38,16 @@ ParallelBplustree::ParallelBplustree(
 		}
 	}
 
-void ParallelBplustree::threadInsert(const int key, const int value) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadInsert(const Key &key, const Value value) {
 	static thread_local std::mt19937 gen;
 	static thread_local std::uniform_int_distribution<int> distr(0, numTrees - 1);
-	if (useBloomFilters) {
+	if (partitioner) {
+		const int treeIndex = partitioner->getPartition(key);
+		std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
+		trees[treeIndex]->insert(key, value);
+	}
+	else if (useBloomFilters) {
 		for (int i = 0; i < numTrees; i++) {
 			std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[i]);
 			if (treeFilters[i]->contains(key)) {
@@ -65,36 +81,98 @@ void ParallelBplustree::threadInsert(const int key, const int value) {
 	}
 }
 
-void ParallelBplustree::insert(const int key, const int value) {
-	threadPool.push_task([=, this] { threadInsert(key, value); });
+template <typename Traits>
+void BasicParallelBplustree<Traits>::insert(const Key &key, const Value value) {
+	throwIfFrozen();
+	pushTreeTask(getOwner(key), [=, this] { threadInsert(key, value); });
 }
 
-void ParallelBplustree::threadInsert(
-		std::vector<int>::iterator keysSplitBegin,
-		std::vector<int>::iterator keysSplitEnd,
-		std::vector<int>::iterator valuesSplitBegin,
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadInsert(
+		typename std::vector<Key>::iterator keysSplitBegin,
+		typename std::vector<Key>::iterator keysSplitEnd,
+		typename std::vector<Value>::iterator valuesSplitBegin,
 		const int treeIndex) {
+	/*
+	Hands the split to Bplustree::insertBatch, which descends once per
+	leaf instead of once per pair. With a partitioner the pairs are first
+	grouped by the tree of their key, with bloom filters by the tree that
+	already holds the key, or a random tree. The filters are only updated
+	once the split has been inserted, so the tree drawn for a new key is
+	remembered for its later copies in the split.
+	*/
 	if (treeIndex > -1) {
+		std::vector<Key> batchKeys(keysSplitBegin, keysSplitEnd);
+		std::vector<Value> batchValues(valuesSplitBegin, valuesSplitBegin + batchKeys.size());
 		std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
-		for(std::vector<int>::iterator keysSplitIt = keysSplitBegin; keysSplitIt != keysSplitEnd; keysSplitIt++, valuesSplitBegin++) {
-			trees[treeIndex]->insert(*keysSplitIt, *valuesSplitBegin);
-		}
+		trees[treeIndex]->insertBatch(batchKeys, batchValues);
 	}
 	else {
-		for(std::vector<int>::iterator keysSplitIt = keysSplitBegin; keysSplitIt != keysSplitEnd; keysSplitIt++, valuesSplitBegin++) {
-			threadInsert(*keysSplitIt, *valuesSplitBegin);
+		static thread_local std::mt19937 gen;
+		std::uniform_int_distribution<int> distr(0, numTrees - 1);
+		std::vector<std::vector<Key>> batchKeys(numTrees);
+		std::vector<std::vector<Value>> batchValues(numTrees);
+		std::map<Key, int, typename Traits::Compare> newKeyTrees;
+		for(typename std::vector<Key>::iterator keysSplitIt = keysSplitBegin; keysSplitIt != keysSplitEnd; keysSplitIt++, valuesSplitBegin++) {
+			int targetTree = partitioner ? partitioner->getPartition(*keysSplitIt) : -1;
+			for (int i = 0; i < numTrees && targetTree < 0; i++) {
+				std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[i]);
+				if (treeFilters[i]->contains(*keysSplitIt)) {
+					targetTree = i;
+				}
+			}
+			if (targetTree < 0) {
+				typename std::map<Key, int, typename Traits::Compare>::iterator newKeyIt = newKeyTrees.try_emplace(*keysSplitIt, -1).first;
+				if (newKeyIt->second < 0) {
+					newKeyIt->second = distr(gen);
+				}
+				targetTree = newKeyIt->second;
+			}
+			batchKeys[targetTree].push_back(*keysSplitIt);
+			batchValues[targetTree].push_back(*valuesSplitBegin);
+		}
+		for (int i = 0; i < numTrees; i++) {
+			if (batchKeys[i].empty()) {
+				continue;
+			}
+			{
+				std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[i]);
+				trees[i]->insertBatch(batchKeys[i], batchValues[i]);
+			}
+			if (!partitioner) {
+				std::unique_lock<std::shared_mutex> treeFilterWriteLock(*treeFilterLocks[i]);
+				for (const Key &key : batchKeys[i]) {
+					treeFilters[i]->insert(key);
+				}
+			}
 		}
 	}
 }
 
-void ParallelBplustree::insert(std::vector<int> &keys, std::vector<int> &values) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::insert(std::vector<Key> &keys, std::vector<Value> &values) {
+	throwIfFrozen();
 	if (keys.size() != values.size()) {
 		throw "keys.size() and values.size() must be equal\n";
 	}
-	std::vector<int>::iterator keysIt = keys.begin();
-	std::vector<int>::iterator valuesIt = values.begin();
+	typename std::vector<Key>::iterator keysIt = keys.begin();
+	typename std::vector<Value>::iterator valuesIt = values.begin();
 
-	if (useBloomFilters) {
+	if (partitionWorkers) {
+		std::vector<std::vector<Key>> batchKeys(numTrees);
+		std::vector<std::vector<Value>> batchValues(numTrees);
+		for (int i = 0; i < keys.size(); i++) {
+			const int treeIndex = partitioner->getPartition(keys[i]);
+			batchKeys[treeIndex].push_back(keys[i]);
+			batchValues[treeIndex].push_back(values[i]);
+		}
+		for (int i = 0; i < numTrees; i++) {
+			if (!batchKeys[i].empty()) {
+				partitionWorkers->push(i, [i, batchKeys = std::move(batchKeys[i]), batchValues = std::move(batchValues[i]), this] { trees[i]->insertBatch(batchKeys, batchValues); });
+			}
+		}
+	}
+	else if (useBloomFilters || partitioner) {
 		if (keys.size() < numThreads) {
 			throw "Not enough pairs passed, use insert(const int key, const int value) instead\n";
 		}
@@ -110,7 +188,7 @@ void ParallelBplustree::insert(std::vector<int> &keys, std::vector<int> &values)
 				valuesIt + i*splitSize);
 			});
 		}
-		std::vector<int>::iterator keysItEnd = keys.end();
+		typename std::vector<Key>::iterator keysItEnd = keys.end();
 		threadPool.push_task([
 				=,
 				this
@@ -138,7 +216,7 @@ void ParallelBplustree::insert(std::vector<int> &keys, std::vector<int> &values)
 					i);
 			});
 		}
-		std::vector<int>::iterator keysItEnd = keys.end();
+		typename std::vector<Key>::iterator keysItEnd = keys.end();
 		threadPool.push_task([
 				=,
 				this
@@ -152,16 +230,28 @@ void ParallelBplustree::insert(std::vector<int> &keys, std::vector<int> &values)
 	}
 }
 
-void ParallelBplustree::threadSearchCoordinator(
-		const int key,
-		std::promise<std::vector<std::future<const std::vector<int> *>>> *prom
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadSearchCoordinator(
+		const Key &key,
+		std::promise<std::vector<std::future<const ValueSlot *>>> *prom
 	) {
-	std::vector<std::future<const std::vector<int> *>> result;
-	if (useBloomFilters) {
+	std::vector<std::future<const ValueSlot *>> result;
+	if (partitioner) {
+		// Searched right here, this task is on a worker already
+		std::promise<const ValueSlot *> found;
+		found.set_value(threadSearch(key, partitioner->getPartition(key)));
+		result.push_back(found.get_future());
+	}
+	else if (useBloomFilters) {
 		for (int i = 0; i < numTrees; i++) {
-			std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[i]);
+			std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[i], std::defer_lock);
+			if (!frozen.load(std::memory_order_acquire)) {
+				treeFilterReadLock.lock();
+			}
 			if (treeFilters[i]->contains(key)) {
-				treeFilterReadLock.unlock();
+				if (treeFilterReadLock.owns_lock()) {
+					treeFilterReadLock.unlock();
+				}
 				result.push_back(threadPool.submit([=, this] { return threadSearch(key, i); }));
 			}
 		}
@@ -175,47 +265,81 @@ void ParallelBplustree::threadSearchCoordinator(
 	delete prom;
 }
 
-const std::vector<int> *ParallelBplustree::threadSearch(const int key, const int treeIndex) const {
-	std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex]);
+template <typename Traits>
+const typename BasicParallelBplustree<Traits>::ValueSlot *BasicParallelBplustree<Traits>::threadSearch(const Key &key, const int treeIndex) const {
+	std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex], std::defer_lock);
+	if (!frozen.load(std::memory_order_acquire) && !partitionWorkers) {
+		treeReadLock.lock();
+	}
 	return trees[treeIndex]->search(key);
 }
 
-std::future<std::vector<std::future<const std::vector<int> *>>> ParallelBplustree::search(const int key) {
-	std::promise<std::vector<std::future<const std::vector<int> *>>> *prom = new std::promise<std::vector<std::future<const std::vector<int> *>>>;
-	std::future<std::vector<std::future<const std::vector<int> *>>> fut = prom->get_future();
-	threadPool.push_task([=, this] () mutable { threadSearchCoordinator(key, prom); });
+template <typename Traits>
+std::future<std::vector<std::future<const typename BasicParallelBplustree<Traits>::ValueSlot *>>> BasicParallelBplustree<Traits>::search(const Key &key) {
+	std::promise<std::vector<std::future<const ValueSlot *>>> *prom = new std::promise<std::vector<std::future<const ValueSlot *>>>;
+	std::future<std::vector<std::future<const ValueSlot *>>> fut = prom->get_future();
+	pushTreeTask(getOwner(key), [=, this] () mutable { threadSearchCoordinator(key, prom); });
 	return fut;
 }
 
-void ParallelBplustree::threadSearch(const std::vector<int> *batchKeys, const int treeIndex, std::vector<std::vector<const std::vector<int> *>> &result, const std::vector<int> keysPos) {
-	if (useBloomFilters) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadSearch(const std::vector<Key> *batchKeys, const int treeIndex, std::vector<std::vector<const ValueSlot *>> &result, const std::vector<int> keysPos) {
+	std::vector<const ValueSlot *> found;
+	if (useBloomFilters || partitioner) {
 		if (keysPos.size() > 0) {
-			std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex]);
+			std::vector<Key> treeKeys;
+			treeKeys.reserve(keysPos.size());
 			for (int i = 0; i < keysPos.size(); i++) {
-				result[keysPos[i]][treeIndex] = trees[treeIndex]->search((*batchKeys)[keysPos[i]]);
+				treeKeys.push_back((*batchKeys)[keysPos[i]]);
+			}
+			std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex], std::defer_lock);
+			if (!frozen.load(std::memory_order_acquire) && !partitionWorkers) {
+				treeReadLock.lock();
+			}
+			trees[treeIndex]->multiSearch(treeKeys, found);
+			for (int i = 0; i < keysPos.size(); i++) {
+				result[keysPos[i]][treeIndex] = found[i];
 			}
 		}
 	}
 	else {
-		std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex]);
+		std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[treeIndex], std::defer_lock);
+		if (!frozen.load(std::memory_order_acquire) && !partitionWorkers) {
+			treeReadLock.lock();
+		}
+		trees[treeIndex]->multiSearch(*batchKeys, found);
 		for (int i = 0; i < batchKeys->size(); i++) {
-			result[i][treeIndex] = trees[treeIndex]->search((*batchKeys)[i]);
+			result[i][treeIndex] = found[i];
 		}
 	}
 }
 
-std::vector<std::vector<const std::vector<int> *>> ParallelBplustree::search(const std::vector<int> &keys) {
-	std::vector<std::vector<const std::vector<int> *>> result(keys.size(), std::vector<const std::vector<int> *>(numTrees, nullptr));
-	if (useBloomFilters) {
+template <typename Traits>
+std::vector<std::vector<const typename BasicParallelBplustree<Traits>::ValueSlot *>> BasicParallelBplustree<Traits>::search(const std::vector<Key> &keys) {
+	std::vector<std::vector<const ValueSlot *>> result(keys.size(), std::vector<const ValueSlot *>(numTrees, nullptr));
+	if (partitioner) {
+		std::vector<std::vector<int>> keysPos(numTrees);
+		for (int i = 0; i < keys.size(); i++) {
+			keysPos[partitioner->getPartition(keys[i])].push_back(i);
+		}
+		for (int i = 0; i < numTrees; i++) {
+			if (!keysPos[i].empty()) {
+				pushTreeTask(i, [=, keysPos = std::move(keysPos[i]), &result, this] { threadSearch(&keys, i, result, std::move(keysPos)); });
+			}
+		}
+	}
+	else if (useBloomFilters) {
 		std::vector<std::vector<int>> keysPos(numTrees);
 		for (int i = numTrees - 1; i > -1; i--) {
 			keysPos[i].reserve(keys.size() / numTrees);
 		}
 		for (int i = 0; i < keys.size(); i++) {
 			for (int j = 0; j < numTrees; j++) {
-				std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[j]);
+				std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[j], std::defer_lock);
+				if (!frozen.load(std::memory_order_acquire)) {
+					treeFilterReadLock.lock();
+				}
 				if (treeFilters[j]->contains(keys[i])) {
-					treeFilterReadLock.unlock();
 					keysPos[j].push_back(i);
 				}
 			}
@@ -232,15 +356,20 @@ std::vector<std::vector<const std::vector<int> *>> ParallelBplustree::search(con
 	return result;
 }
 
-bool ParallelBplustree::threadUpdate(const int key, const std::vector<int> &values, const int treeIndex) {
-	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
+template <typename Traits>
+bool BasicParallelBplustree<Traits>::threadUpdate(const Key &key, const std::vector<Value> &values, const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
 	return trees[treeIndex]->update(key, values, true);
 }
 
-void ParallelBplustree::threadUpdateCoordinator(const int key, const std::vector<int> &values) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadUpdateCoordinator(const Key &key, const std::vector<Value> &values) {
 	static thread_local std::mt19937 gen;
 	static thread_local std::uniform_int_distribution<int> distr(0, numTrees - 1);
-	if (useBloomFilters) {
+	if (partitioner) {
+		threadUpdate(key, values, partitioner->getPartition(key));
+	}
+	else if (useBloomFilters) {
 		bool keyWasFoundInFilter = false;
 		for (int i = 0; i < numTrees; i++) {
 			std::shared_lock<std::shared_mutex> treeFiltersReadLock(*treeFilterLocks[i]);
@@ -271,21 +400,30 @@ void ParallelBplustree::threadUpdateCoordinator(const int key, const std::vector
 	}
 }
 
-void ParallelBplustree::update(const int key, const std::vector<int> &values) {
-	threadPool.push_task([=, &values, this] { threadUpdateCoordinator(key, values); });
+template <typename Traits>
+void BasicParallelBplustree<Traits>::update(const Key &key, const std::vector<Value> &values) {
+	throwIfFrozen();
+	pushTreeTask(getOwner(key), [=, &values, this] { threadUpdateCoordinator(key, values); });
 }
 
-void ParallelBplustree::threadUpdateThenDelete(std::vector<int> updateKeys, std::vector<int> updateIndexOfValues, const std::vector<std::vector<int>> *updateBatchValues, std::vector<int> deleteKeys, const int treeIndex) {
-	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadUpdateThenDelete(std::vector<Key> updateKeys, std::vector<int> updateIndexOfValues, const std::vector<std::vector<Value>> *updateBatchValues, std::vector<Key> deleteKeys, const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
 	for (int i = 0; i < updateKeys.size(); i++) {
 		trees[treeIndex]->update(updateKeys[i], (*updateBatchValues)[updateIndexOfValues[i]], true);
 	}
 	for (int i = 0; i < deleteKeys.size(); i++) {
 		trees[treeIndex]->remove(deleteKeys[i]);
 	}
+	if (treeWriteLock.owns_lock()) {
+		treeWriteLock.unlock();
+	}
+	scheduleCompaction(treeIndex);
 }
 
-void ParallelBplustree::update(std::vector<int> &keys, std::vector<std::vector<int>> &values) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::update(std::vector<Key> &keys, std::vector<std::vector<Value>> &values) {
+	throwIfFrozen();
 	if (keys.size() != values.size()) {
 		throw std::string("Keys size and values size must be equal!\n");
 	}
@@ -294,10 +432,17 @@ void ParallelBplustree::update(std::vector<int> &keys, std::vector<std::vector<i
 	}
 	static thread_local std::mt19937 gen;
 	static thread_local std::uniform_int_distribution<int> distr(0, numTrees - 1);
-	std::vector<std::vector<int>> updateKeys(numTrees);
+	std::vector<std::vector<Key>> updateKeys(numTrees);
 	std::vector<std::vector<int>> updateIndexOfValues(numTrees);
-	std::vector<std::vector<int>> deleteKeys(numTrees);
-	if (useBloomFilters) {
+	std::vector<std::vector<Key>> deleteKeys(numTrees);
+	if (partitioner) {
+		for (int i = 0; i < keys.size(); i++) {
+			const int treeIndex = partitioner->getPartition(keys[i]);
+			updateKeys[treeIndex].push_back(keys[i]);
+			updateIndexOfValues[treeIndex].push_back(i);
+		}
+	}
+	else if (useBloomFilters) {
 		for (int i = 0; i < numTrees; i++) {
 			updateKeys[i].reserve(keys.size() / numTrees);
 			updateIndexOfValues[i].reserve(values.size() / numTrees);
@@ -356,8 +501,9 @@ void ParallelBplustree::update(std::vector<int> &keys, std::vector<std::vector<i
 		}
 	}
 	for (int i = 0; i < numTrees; i++) {
-		threadPool.push_task([
+		pushTreeTask(i, [
 				=,
+				&values,
 				updateKeys = std::move(updateKeys[i]),
 				updateIndexOfValues = std::move(updateIndexOfValues[i]),
 				deleteKeys = std::move(deleteKeys[i]),
@@ -373,14 +519,26 @@ void ParallelBplustree::update(std::vector<int> &keys, std::vector<std::vector<i
 	}
 }
 
-bool ParallelBplustree::threadRemove(const int key, const int treeIndex) {
-	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
-	return trees[treeIndex]->remove(key);
+template <typename Traits>
+bool BasicParallelBplustree<Traits>::threadRemove(const Key &key, const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
+	const bool keyWasRemoved = trees[treeIndex]->remove(key);
+	if (treeWriteLock.owns_lock()) {
+		treeWriteLock.unlock();
+	}
+	scheduleCompaction(treeIndex);
+	return keyWasRemoved;
 }
 
-void ParallelBplustree::threadRemoveCoordinator(const int key, std::promise<std::vector<std::future<bool>>> *prom) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadRemoveCoordinator(const Key &key, std::promise<std::vector<std::future<bool>>> *prom) {
 	std::vector<std::future<bool>> result;
-	if (useBloomFilters) {
+	if (partitioner) {
+		std::promise<bool> removed;
+		removed.set_value(threadRemove(key, partitioner->getPartition(key)));
+		result.push_back(removed.get_future());
+	}
+	else if (useBloomFilters) {
 		for (int i = 0; i < numTrees; i++) {
 			std::shared_lock<std::shared_mutex> treeFilterReadLock(*treeFilterLocks[i]);
 			if (treeFilters[i]->contains(key)) {
@@ -398,30 +556,55 @@ void ParallelBplustree::threadRemoveCoordinator(const int key, std::promise<std:
 	delete prom;
 }
 
-std::future<std::vector<std::future<bool>>> ParallelBplustree::remove(const int key) {
+template <typename Traits>
+std::future<std::vector<std::future<bool>>> BasicParallelBplustree<Traits>::remove(const Key &key) {
+	throwIfFrozen();
 	std::promise<std::vector<std::future<bool>>> *prom = new std::promise<std::vector<std::future<bool>>>;
 	std::future<std::vector<std::future<bool>>> fut = prom->get_future();
-	threadPool.push_task([=, this] () mutable { threadRemoveCoordinator(key, prom); });
+	pushTreeTask(getOwner(key), [=, this] () mutable { threadRemoveCoordinator(key, prom); });
 	return fut;
 }
 
-void ParallelBplustree::threadRemove(std::vector<int> keys, const int treeIndex) {
-	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
-	for (int key : keys) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadRemove(std::vector<Key> keys, const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
+	for (const Key &key : keys) {
 		trees[treeIndex]->remove(key);
 	}
+	if (treeWriteLock.owns_lock()) {
+		treeWriteLock.unlock();
+	}
+	scheduleCompaction(treeIndex);
 }
 
-void ParallelBplustree::threadRemove(std::vector<int> *keys, const int treeIndex) {
-	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex]);
-	for (int key : *keys) {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadRemove(std::vector<Key> *keys, const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
+	for (const Key &key : *keys) {
 		trees[treeIndex]->remove(key);
 	}
+	if (treeWriteLock.owns_lock()) {
+		treeWriteLock.unlock();
+	}
+	scheduleCompaction(treeIndex);
 }
 
-void ParallelBplustree::remove(std::vector<int> &keys) {
-	if (useBloomFilters) {
-		std::vector<std::vector<int>> keysForTrees(numTrees);
+template <typename Traits>
+void BasicParallelBplustree<Traits>::remove(std::vector<Key> &keys) {
+	throwIfFrozen();
+	if (partitioner) {
+		std::vector<std::vector<Key>> keysForTrees(numTrees);
+		for (const Key &key : keys) {
+			keysForTrees[partitioner->getPartition(key)].push_back(key);
+		}
+		for (int i = 0; i < numTrees; i++) {
+			if (keysForTrees[i].size() > 0) {
+				pushTreeTask(i, [=, keys = std::move(keysForTrees[i]), this] { threadRemove(std::move(keys), i); });
+			}
+		}
+	}
+	else if (useBloomFilters) {
+		std::vector<std::vector<Key>> keysForTrees(numTrees);
 		for (int i = 0; i < numTrees; i++) {
 			keysForTrees[i].reserve(keys.size()/numTrees);
 		}
@@ -447,7 +630,328 @@ void ParallelBplustree::remove(std::vector<int> &keys) {
 	}
 }
 
-std::vector<int> ParallelBplustree::getTreeNumKeys() {
+template <typename Traits>
+long long BasicParallelBplustree<Traits>::removeRange(const Key &start, const Key &end) {
+	/*
+	Removes the keys of [start, end] from every tree in parallel, each
+	under its write lock, and returns the number of keys removed. As for
+	remove, the bloom filters keep the removed keys.
+	*/
+	throwIfFrozen();
+	std::vector<long long> treeRemoved(numTrees);
+	modifyTrees([&](const int treeIndex, Bplustree *tree) {
+		treeRemoved[treeIndex] = tree->removeRange(start, end);
+	});
+	long long total = 0;
+	for (int i = 0; i < numTrees; i++) {
+		scheduleCompaction(i);
+		total += treeRemoved[i];
+	}
+	return total;
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::setRelaxedRemoves(const bool relaxed, const double compactionThreshold) {
+	/*
+	In relaxed mode removes leave sparse leaves behind instead of
+	rebalancing under the tree lock. A tree is compacted by a task on
+	the thread pool once its deferred removes reach compactionThreshold
+	times its number of leaves.
+	*/
+	if (compactionThreshold <= 0) {
+		throw std::string("compactionThreshold must be positive\n");
+	}
+	relaxedRemoves = relaxed;
+	this->compactionThreshold = compactionThreshold;
+	modifyTrees([relaxed](const int treeIndex, Bplustree *tree) {
+		tree->setRelaxedRemoves(relaxed);
+	});
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::setPartitioner(const Partitioner<Traits> *partitioner) {
+	/*
+	From now on every key goes to the tree partitioner gives for it, and
+	point operations touch that tree only, skipping the bloom filters.
+	Ownership of partitioner passes to this object, also when it throws.
+	As keys placed before would not be found, it must be set while the
+	trees are empty.
+	*/
+	throwIfFrozen();
+	if (partitioner->getNumPartitions() != numTrees) {
+		delete partitioner;
+		throw std::string("partitioner must have as many partitions as there are trees\n");
+	}
+	waitForWorkToFinish();
+	for (int i = 0; i < numTrees; i++) {
+		if (trees[i]->getNumKeysStored() > 0) {
+			delete partitioner;
+			throw std::string("partitioner must be set while the trees are empty\n");
+		}
+	}
+	delete this->partitioner;
+	this->partitioner = partitioner;
+}
+
+template <typename Traits>
+const Partitioner<Traits> *BasicParallelBplustree<Traits>::getPartitioner() const {
+	return partitioner;
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::setSharedNothing(const bool enabled) {
+	/*
+	In shared-nothing mode every tree is owned by a worker pinned to a
+	core, which runs all operations on the tree from its inbox without
+	taking the tree lock, so that no lock moves between cores. Point
+	operations are routed to the owner of the tree the partitioner gives
+	for the key, batches are split among the owners by the caller, and
+	operations over all trees run on every owner. The thread pool is
+	left idle. Switching must not overlap operations issued from other
+	threads.
+	*/
+	if (enabled && !partitioner) {
+		throw std::string("shared-nothing mode needs a partitioner, set one by setPartitioner\n");
+	}
+	if (enabled == (partitionWorkers != nullptr)) {
+		return;
+	}
+	waitForWorkToFinish();
+	if (enabled) {
+		partitionWorkers = new PartitionWorkers(numTrees);
+	}
+	else {
+		delete partitionWorkers;
+		partitionWorkers = nullptr;
+	}
+}
+
+template <typename Traits>
+bool BasicParallelBplustree<Traits>::isSharedNothing() const {
+	return partitionWorkers != nullptr;
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::freeze() {
+	/*
+	Waits for queued work, then freezes the trees in parallel, each
+	under its write lock. Once all are frozen, reads skip the tree and
+	filter locks, as nothing can modify the trees until thaw(). Freezing
+	and thawing must not overlap operations issued from other threads.
+	*/
+	if (frozen.load()) {
+		return;
+	}
+	waitForWorkToFinish();
+	modifyTrees([](const int treeIndex, Bplustree *tree) {
+		tree->freeze();
+	});
+	frozen.store(true, std::memory_order_release);
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::thaw() {
+	/*
+	Waits for the reads in flight, which may hold no locks, before the
+	frozen images are released.
+	*/
+	if (!frozen.load()) {
+		return;
+	}
+	waitForWorkToFinish();
+	frozen.store(false, std::memory_order_release);
+	modifyTrees([](const int treeIndex, Bplustree *tree) {
+		tree->thaw();
+	});
+}
+
+template <typename Traits>
+bool BasicParallelBplustree<Traits>::isFrozen() const {
+	return frozen.load();
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::setSubtreeCounts(const bool enabled) {
+	subtreeCounts = enabled;
+	modifyTrees([enabled](const int treeIndex, Bplustree *tree) {
+		tree->setSubtreeCounts(enabled);
+	});
+}
+
+template <typename Traits>
+template <typename Query>
+void BasicParallelBplustree<Traits>::queryTrees(const Query &query) {
+	/*
+	Runs query(treeIndex, tree) on every tree in parallel, each under its
+	read lock unless the trees are frozen, or by its owner in
+	shared-nothing mode.
+	*/
+	if (partitionWorkers) {
+		for (int i = 0; i < numTrees; i++) {
+			partitionWorkers->push(i, [&query, i, this] { query(i, trees[i]); });
+		}
+		partitionWorkers->wait();
+		return;
+	}
+	threadPool.parallelize_loop(0, numTrees, [&](const int first, const int last) {
+		for (int i = first; i < last; i++) {
+			std::shared_lock<std::shared_mutex> treeReadLock(*treeLocks[i], std::defer_lock);
+			if (!frozen.load(std::memory_order_acquire)) {
+				treeReadLock.lock();
+			}
+			query(i, trees[i]);
+		}
+	});
+}
+
+template <typename Traits>
+template <typename Modify>
+void BasicParallelBplustree<Traits>::modifyTrees(const Modify &modify) {
+	/*
+	Runs modify(treeIndex, tree) on every tree in parallel, each under
+	its write lock, or by its owner in shared-nothing mode.
+	*/
+	if (partitionWorkers) {
+		for (int i = 0; i < numTrees; i++) {
+			partitionWorkers->push(i, [&modify, i, this] { modify(i, trees[i]); });
+		}
+		partitionWorkers->wait();
+		return;
+	}
+	threadPool.parallelize_loop(0, numTrees, [&](const int first, const int last) {
+		for (int i = first; i < last; i++) {
+			std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[i]);
+			modify(i, trees[i]);
+		}
+	});
+}
+
+template <typename Traits>
+template <typename Count>
+long long BasicParallelBplustree<Traits>::sumTreeCounts(const Count &count) {
+	/*
+	Runs count on every tree and sums the results. Counting throws here
+	rather than in a task of the pool.
+	*/
+	if (!subtreeCounts && !frozen.load()) {
+		throw std::string("subtree counts are disabled, enable them by setSubtreeCounts\n");
+	}
+	std::vector<long long> treeCounts(numTrees);
+	queryTrees([&](const int treeIndex, const Bplustree *tree) {
+		treeCounts[treeIndex] = count(tree);
+	});
+	long long total = 0;
+	for (long long treeCount : treeCounts) {
+		total += treeCount;
+	}
+	return total;
+}
+
+template <typename Traits>
+long long BasicParallelBplustree<Traits>::rank(const Key &key) {
+	/*
+	Ranks and range counts are sums over all trees. With a partitioner
+	each key has a single tree, so the per-tree counts are exact. Only
+	when keys are placed at random without bloom filters may a key be
+	held by several trees, and it is then counted once per tree.
+	*/
+	return sumTreeCounts([&key](const Bplustree *tree) { return tree->rank(key); });
+}
+
+template <typename Traits>
+long long BasicParallelBplustree<Traits>::countRange(const Key &start, const Key &end) {
+	return sumTreeCounts([&start, &end](const Bplustree *tree) { return tree->countRange(start, end); });
+}
+
+template <typename Traits>
+typename BasicParallelBplustree<Traits>::Aggregate BasicParallelBplustree<Traits>::aggregate(const Key &start, const Key &end) {
+	/*
+	Aggregates the values of [start, end] in every tree and combines the
+	partial results. As for countRange, a key held by several trees
+	contributes its values once per tree.
+	*/
+	std::vector<Aggregate> treeAggregates(numTrees);
+	queryTrees([&](const int treeIndex, const Bplustree *tree) {
+		treeAggregates[treeIndex] = tree->aggregate(start, end);
+	});
+	Aggregate total;
+	for (const Aggregate &treeAggregate : treeAggregates) {
+		total.add(treeAggregate);
+	}
+	return total;
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::throwIfFrozen() const {
+	if (frozen.load(std::memory_order_relaxed)) {
+		throw std::string("trees are frozen, thaw them before modifying them\n");
+	}
+}
+
+template <typename Traits>
+int BasicParallelBplustree<Traits>::getOwner(const Key &key) const {
+	/*
+	The tree whose owner runs the operations on key in shared-nothing
+	mode, -1 otherwise.
+	*/
+	return partitionWorkers ? partitioner->getPartition(key) : -1;
+}
+
+template <typename Traits>
+std::unique_lock<std::shared_mutex> BasicParallelBplustree<Traits>::lockTree(const int treeIndex) {
+	/*
+	Write lock of the tree, left unlocked in shared-nothing mode, where
+	only the owner of the tree reaches it.
+	*/
+	std::unique_lock<std::shared_mutex> treeWriteLock(*treeLocks[treeIndex], std::defer_lock);
+	if (!partitionWorkers) {
+		treeWriteLock.lock();
+	}
+	return treeWriteLock;
+}
+
+template <typename Traits>
+template <typename Task>
+void BasicParallelBplustree<Traits>::pushTreeTask(const int treeIndex, const Task &task) {
+	/*
+	Queues a task on the given tree to the inbox of its owner in
+	shared-nothing mode, otherwise, or for treeIndex -1, to the pool.
+	*/
+	if (partitionWorkers && treeIndex > -1) {
+		partitionWorkers->push(treeIndex, task);
+	}
+	else {
+		threadPool.push_task(task);
+	}
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::scheduleCompaction(const int treeIndex) {
+	/*
+	Called after removes on a tree, outside its lock. At most one
+	compaction per tree is pending at a time.
+	*/
+	if (!relaxedRemoves || !trees[treeIndex]->needsCompaction(compactionThreshold)) {
+		return;
+	}
+	if (!compactionScheduled[treeIndex].exchange(true)) {
+		pushTreeTask(treeIndex, [=, this] { threadCompact(treeIndex); });
+	}
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::threadCompact(const int treeIndex) {
+	std::unique_lock<std::shared_mutex> treeWriteLock = lockTree(treeIndex);
+	trees[treeIndex]->compact();
+	compactionScheduled[treeIndex].store(false);
+}
+
+template <typename Traits>
+std::vector<int> BasicParallelBplustree<Traits>::getTreeNumKeys() {
+	/*
+	Trees keep their statistics in relaxed atomics, so they can be read
+	without taking the tree locks and stalling writers.
+	*/
 	std::vector<int> result;
 	for (int i = 0; i < numTrees; i++) {
 		result.push_back(trees[i]->getNumKeysStored());
@@ -455,17 +959,38 @@ std::vector<int> ParallelBplustree::getTreeNumKeys() {
 	return result;
 }
 
-void ParallelBplustree::waitForWorkToFinish() {
+template <typename Traits>
+std::vector<TreeStats> BasicParallelBplustree<Traits>::getTreeStats() {
+	std::vector<TreeStats> result;
+	for (int i = 0; i < numTrees; i++) {
+		result.push_back(trees[i]->getStats());
+	}
+	return result;
+}
+
+template <typename Traits>
+void BasicParallelBplustree<Traits>::waitForWorkToFinish() {
+	/*
+	Tasks of the owners never queue work to the pool, so once the pool
+	is done, the owners only have to run out of work.
+	*/
 	threadPool.wait_for_tasks();
+	if (partitionWorkers) {
+		partitionWorkers->wait();
+	}
 }
 
-void ParallelBplustree::show() {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::show() {
 	for (int i = 0; i < numTrees; i++) {
 		trees[i]->show();
 	}
 }
 
-ParallelBplustree::~ParallelBplustree() {
+template <typename Traits>
+BasicParallelBplustree<Traits>::~BasicParallelBplustree() {
+	waitForWorkToFinish();
+	delete partitionWorkers;
 	for (int i = 0; i < numTrees; i++) {
 		delete trees[i];
 		delete treeLocks[i];
@@ -474,28 +999,37 @@ ParallelBplustree::~ParallelBplustree() {
 			delete treeFilterLocks[i];
 		}
 	}
+	delete partitioner;
 }
 
-int ParallelBplustree::getOrder() {
+template <typename Traits>
+int BasicParallelBplustree<Traits>::getOrder() {
 	return order;
 }
 
-int ParallelBplustree::getNumThreads() {
+template <typename Traits>
+int BasicParallelBplustree<Traits>::getNumThreads() {
 	return numThreads;
 }
 
-int ParallelBplustree::getNumTrees() {
+template <typename Traits>
+int BasicParallelBplustree<Traits>::getNumTrees() {
 	return numTrees;
 }
 
-bool ParallelBplustree::areBloomFiltersUsed() {
+template <typename Traits>
+bool BasicParallelBplustree<Traits>::areBloomFiltersUsed() {
 	return useBloomFilters;
 }
 
-void ParallelBplustree::pauseThreadPool() {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::pauseThreadPool() {
 	threadPool.paused = true;
 }
 
-void ParallelBplustree::resumeThreadPool() {
+template <typename Traits>
+void BasicParallelBplustree<Traits>::resumeThreadPool() {
 	threadPool.paused = false;
 }
+
+BPLUSTREE_INSTANTIATE(BasicParallelBplustree)
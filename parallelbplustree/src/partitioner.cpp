@@ -0,0 +1,68 @@
+#include "partitioner.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+template <typename Traits>
+Partitioner<Traits>::Partitioner(const int numPartitions) :
+	numPartitions(numPartitions) {
+	if (numPartitions < 1) {
+		throw std::string("numPartitions must be positive\n");
+	}
+}
+
+template <typename Traits>
+HashPartitioner<Traits>::HashPartitioner(const int numPartitions) :
+	Partitioner<Traits>(numPartitions) {}
+
+template <typename Traits>
+int HashPartitioner<Traits>::getPartition(const Key &key) const {
+	/*
+	Folds the key into 64 bits a word at a time with the splitmix64
+	finalizer, then scales the hash to a partition by a multiply, which
+	is cheaper than a modulo.
+	*/
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&key);
+	std::uint64_t hash = 0;
+	for (std::size_t i = 0; i < sizeof(Key); i += sizeof(std::uint64_t)) {
+		std::uint64_t word = 0;
+		std::memcpy(&word, bytes + i, std::min(sizeof(std::uint64_t), sizeof(Key) - i));
+		hash ^= word;
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+		hash ^= hash >> 31;
+	}
+	return ((hash >> 32) * static_cast<std::uint64_t>(this->numPartitions)) >> 32;
+}
+
+template <typename Traits>
+RangePartitioner<Traits>::RangePartitioner(const int numPartitions, std::vector<Key> sample) :
+	Partitioner<Traits>(numPartitions) {
+	/*
+	Boundary i - 1 is the sample key at the i-th numPartitions-quantile.
+	A skewed sample may repeat boundaries, leaving some partitions empty.
+	*/
+	if (sample.empty()) {
+		throw std::string("a range partitioner needs a sample of keys\n");
+	}
+	std::sort(sample.begin(), sample.end(), Compare());
+	boundaries.reserve(numPartitions - 1);
+	for (int i = 1; i < numPartitions; i++) {
+		boundaries.push_back(sample[static_cast<std::size_t>(i) * sample.size() / numPartitions]);
+	}
+}
+
+template <typename Traits>
+int RangePartitioner<Traits>::getPartition(const Key &key) const {
+	return std::upper_bound(boundaries.begin(), boundaries.end(), key, Compare()) - boundaries.begin();
+}
+
+template <typename Traits>
+const std::vector<typename RangePartitioner<Traits>::Key> &RangePartitioner<Traits>::getBoundaries() const {
+	return boundaries;
+}
+
+BPLUSTREE_INSTANTIATE(Partitioner)
+BPLUSTREE_INSTANTIATE(HashPartitioner)
+BPLUSTREE_INSTANTIATE(RangePartitioner)
@@ -0,0 +1,115 @@
+#include "partitionworkers.hpp"
+#include <string>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+PartitionWorkers::PartitionWorkers(const int numPartitions) :
+	numPartitions(numPartitions),
+	pending(0) {
+		/*
+		Pins worker i to the i-th core the process may run on, wrapping
+		around when there are more partitions than cores. Pinning is
+		best effort, a worker that cannot be pinned runs unpinned.
+		*/
+		if (numPartitions < 1) {
+			throw std::string("numPartitions must be positive\n");
+		}
+#ifdef __linux__
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		std::vector<int> cores;
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+			for (int core = 0; core < CPU_SETSIZE; core++) {
+				if (CPU_ISSET(core, &allowed)) {
+					cores.push_back(core);
+				}
+			}
+		}
+#endif
+		for (int i = 0; i < numPartitions; i++) {
+			inboxes.push_back(new Inbox);
+		}
+		for (int i = 0; i < numPartitions; i++) {
+			workers.emplace_back(&PartitionWorkers::work, this, i);
+#ifdef __linux__
+			if (!cores.empty()) {
+				cpu_set_t core;
+				CPU_ZERO(&core);
+				CPU_SET(cores[i % cores.size()], &core);
+				pthread_setaffinity_np(workers.back().native_handle(), sizeof(core), &core);
+			}
+#endif
+		}
+	}
+
+PartitionWorkers::~PartitionWorkers() {
+	wait();
+	for (Inbox *inbox : inboxes) {
+		std::lock_guard<std::mutex> inboxLock(inbox->mutex);
+		inbox->stopping = true;
+		inbox->ready.notify_one();
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	for (Inbox *inbox : inboxes) {
+		delete inbox;
+	}
+}
+
+void PartitionWorkers::push(const int partition, std::function<void()> task) {
+	/*
+	Tasks may be pushed from any thread, including the workers. pending
+	is raised first, so that it cannot drop to zero while a worker pushes
+	a follow-up task.
+	*/
+	pending.fetch_add(1);
+	Inbox *inbox = inboxes[partition];
+	std::lock_guard<std::mutex> inboxLock(inbox->mutex);
+	inbox->tasks.push_back(std::move(task));
+	if (inbox->tasks.size() == 1) {
+		inbox->ready.notify_one();
+	}
+}
+
+void PartitionWorkers::wait() {
+	/*
+	Returns once every task pushed, by this or any other thread, has run.
+	*/
+	std::unique_lock<std::mutex> idleLock(idleMutex);
+	idle.wait(idleLock, [this] { return pending.load() == 0; });
+}
+
+int PartitionWorkers::getNumPartitions() const {
+	return numPartitions;
+}
+
+void PartitionWorkers::work(const int partition) {
+	/*
+	Takes the whole inbox at once and runs it outside the inbox lock, so
+	that pushing never waits on a running task.
+	*/
+	Inbox *inbox = inboxes[partition];
+	std::vector<std::function<void()>> batch;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> inboxLock(inbox->mutex);
+			inbox->ready.wait(inboxLock, [inbox] { return !inbox->tasks.empty() || inbox->stopping; });
+			if (inbox->tasks.empty()) {
+				return;
+			}
+			batch.swap(inbox->tasks);
+		}
+		for (std::function<void()> &task : batch) {
+			task();
+		}
+		const long long numRun = batch.size();
+		batch.clear();
+		if (pending.fetch_sub(numRun) == numRun) {
+			std::lock_guard<std::mutex> idleLock(idleMutex);
+			idle.notify_all();
+		}
+	}
+}
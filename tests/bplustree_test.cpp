@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "bplustree.hpp"
+#include "nodesearch.hpp"
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
 
 class BplustreeTest : public ::testing::Test {
 	protected:
@@ -31,7 +37,7 @@ TEST(BplustreeInsertTest, InsertDuplicateKeysTest) {
 }
 
 TEST_F(BplustreeTest, SearchForKeysInTreeTest) {
-	const std::vector<int> *res;
+	const ValueSlot *res;
 	for (int i = 0; i < 30; i += 10) {
 		res = tree.search(i);
 		EXPECT_TRUE(res);
@@ -46,13 +52,28 @@ TEST_F(BplustreeTest, SearchForKeysInTreeTest) {
 }
 
 TEST_F(BplustreeTest, SearchForKeyNotInTreeTest) {
-	const std::vector<int> *res = tree.search(1001);
+	const ValueSlot *res = tree.search(1001);
 	EXPECT_FALSE(res);
 }
 
+TEST_F(BplustreeTest, MultiSearchTest) {
+	std::vector<int> keys;
+	for (int i = -10; i < 1100; i += 3) {
+		keys.push_back(i);
+	}
+	for (int groupSize : {1, 5, 16, 1000}) {
+		std::vector<const ValueSlot *> results;
+		tree.multiSearch(keys, results, groupSize);
+		EXPECT_EQ(keys.size(), results.size());
+		for (int i = 0; i < keys.size(); i++) {
+			EXPECT_EQ(tree.search(keys[i]), results[i]);
+		}
+	}
+}
+
 TEST_F(BplustreeTest, UpdateKeyInTreeTest) {
 	tree.update(500, {1, 2});
-	const std::vector<int> *res = tree.search(500);
+	const ValueSlot *res = tree.search(500);
 	EXPECT_TRUE(res);
 	EXPECT_EQ(res->size(), 2);
 	EXPECT_EQ((*res)[0], 1);
@@ -61,7 +82,7 @@ TEST_F(BplustreeTest, UpdateKeyInTreeTest) {
 
 TEST_F(BplustreeTest, UpdateKeyNotInTreeTest) {
 	tree.update(1001, {1, 2});
-	const std::vector<int> *res = tree.search(1001);
+	const ValueSlot *res = tree.search(1001);
 	EXPECT_FALSE(res);
 	tree.update(1001, {1, 2}, true);
 	res = tree.search(1001);
@@ -72,7 +93,7 @@ TEST_F(BplustreeTest, UpdateKeyNotInTreeTest) {
 }
 
 TEST_F(BplustreeTest, DeleteKeyInTreeTest) {
-	const std::vector<int> *res = tree.search(500);
+	const ValueSlot *res = tree.search(500);
 	EXPECT_TRUE(res);
 	int oldSize = tree.getNumKeysStored();
 	tree.remove(500);
@@ -82,7 +103,7 @@ TEST_F(BplustreeTest, DeleteKeyInTreeTest) {
 }
 
 TEST_F(BplustreeTest, DeleteKeyNotInTreeTest) {
-	const std::vector<int> *res = tree.search(1001);
+	const ValueSlot *res = tree.search(1001);
 	EXPECT_FALSE(res);
 	int oldSize = tree.getNumKeysStored();
 	tree.remove(1001);
@@ -90,3 +111,611 @@ TEST_F(BplustreeTest, DeleteKeyNotInTreeTest) {
 	EXPECT_FALSE(res);
 	EXPECT_EQ(oldSize, tree.getNumKeysStored());
 }
+
+TEST_F(BplustreeTest, TreeStatsTest) {
+	TreeStats stats = tree.getStats();
+	EXPECT_EQ(1000, stats.numKeys);
+	EXPECT_EQ(1000, stats.numValues);
+	// Every split adds one node, and every root split adds a new root as well
+	EXPECT_EQ(stats.numLeaves + stats.numInternalNodes - stats.height, stats.numSplits);
+	EXPECT_GT(stats.height, 1);
+	tree.insert(0, 2);
+	tree.update(1, {1, 2, 3});
+	EXPECT_EQ(1000, tree.getStats().numKeys);
+	EXPECT_EQ(1003, tree.getStats().numValues);
+	for (int i = 0; i < 1000; i++) {
+		tree.remove(i);
+	}
+	stats = tree.getStats();
+	EXPECT_EQ(0, stats.numKeys);
+	EXPECT_EQ(0, stats.numValues);
+	EXPECT_EQ(1, stats.height);
+	EXPECT_EQ(1, stats.numLeaves);
+	EXPECT_EQ(0, stats.numInternalNodes);
+	EXPECT_GT(stats.numMerges, 0);
+}
+
+TEST(BplustreeInsertTest, InsertBatchTest) {
+	Bplustree tree(4);
+	Bplustree expected(4);
+	for (int i = 0; i < 300; i += 3) {
+		tree.insert(i, i);
+		expected.insert(i, i);
+	}
+	std::vector<int> keys;
+	std::vector<int> values;
+	for (int i = 0; i < 2000; i++) {
+		keys.push_back((i * 7919) % 1000);
+		values.push_back(i);
+		expected.insert(keys.back(), values.back());
+	}
+	tree.insertBatch(keys, values);
+	EXPECT_EQ(expected.scanFull(), tree.scanFull());
+	EXPECT_EQ(1000, tree.getNumKeysStored());
+	TreeStats stats = tree.getStats();
+	EXPECT_EQ(2100, stats.numValues);
+	EXPECT_EQ(stats.numLeaves + stats.numInternalNodes - stats.height, stats.numSplits);
+	for (int i = 0; i < 1000; i += 2) {
+		EXPECT_TRUE(tree.remove(i));
+	}
+	EXPECT_EQ(500, tree.getNumKeysStored());
+}
+
+TEST(BplustreeInsertTest, AppendAscendingKeysTest) {
+	Bplustree tree(64);
+	for (int i = 0; i < 100000; i++) {
+		tree.insert(i, i + 1);
+	}
+	TreeStats stats = tree.getStats();
+	EXPECT_EQ(100000, stats.numKeys);
+	EXPECT_EQ(100000, stats.numAppends);
+	EXPECT_GT(stats.numKeys, 0.85 * stats.numLeaves * 63);
+	tree.insert(-1, 0);
+	tree.insert(50000, 7);
+	EXPECT_EQ(100000, tree.getStats().numAppends);
+	for (int i = -1; i < 100000; i += 7) {
+		const ValueSlot *res = tree.search(i);
+		ASSERT_TRUE(res);
+		EXPECT_EQ(i + 1, (*res)[0]);
+	}
+	EXPECT_EQ(2, tree.search(50000)->size());
+	EXPECT_EQ(100001, tree.scanFull().size());
+}
+
+TEST(BplustreeInsertTest, SearchHintTest) {
+	Bplustree tree(16);
+	Bplustree::SearchHint hint;
+	for (int i = 0; i < 20000; i += 2) {
+		tree.insert(i, i + 1, &hint);
+	}
+	EXPECT_EQ(10000, tree.getNumKeysStored());
+	EXPECT_GT(hint.getNumHits(), 0);
+	const long long numDescents = hint.getNumDescents();
+	for (int i = 0; i < 20000; i++) {
+		const ValueSlot *res = tree.search(i, &hint);
+		ASSERT_EQ(i % 2 == 0, res != nullptr);
+		if (res) {
+			EXPECT_EQ(i + 1, (*res)[0]);
+		}
+	}
+	EXPECT_LT(hint.getNumDescents() - numDescents, 20000 / 50);
+	EXPECT_GT(hint.getNumWalks(), 0);
+	for (int i = 19999; i >= 0; i -= 3) {
+		EXPECT_EQ(i % 2 == 0, tree.update(i, {i}, &hint));
+	}
+	for (int i = 1; i < 20000; i += 4) {
+		tree.remove(i - 1);
+		EXPECT_TRUE(tree.update(i, {i}, &hint, true));
+	}
+	Bplustree::SearchHint otherHint;
+	for (int i = 0; i < 20000; i += 5) {
+		const ValueSlot *res = tree.search(i, &otherHint);
+		ASSERT_EQ(tree.search(i), res);
+		EXPECT_EQ(res, tree.search(i, &hint));
+	}
+}
+
+TEST(BplustreeInsertTest, SubtreeCountsTest) {
+	FixedBplustree<16> tree(16);
+	tree.setSubtreeCounts(true);
+	std::set<int> keys;
+	std::mt19937 gen(3);
+	for (int i = 0; i < 20000; i++) {
+		const int key = gen() % 10000;
+		if (i % 3 == 2) {
+			tree.remove(key);
+			keys.erase(key);
+		}
+		else {
+			tree.insert(key, key);
+			keys.insert(key);
+		}
+	}
+	std::vector<int> batchKeys(500);
+	std::iota(batchKeys.begin(), batchKeys.end(), 9800);
+	tree.insertBatch(batchKeys, batchKeys);
+	keys.insert(batchKeys.begin(), batchKeys.end());
+	int rank = 0;
+	for (int key : keys) {
+		int selected;
+		ASSERT_TRUE(tree.select(rank, &selected));
+		EXPECT_EQ(key, selected);
+		EXPECT_EQ(rank, tree.rank(key));
+		rank++;
+	}
+	EXPECT_FALSE(tree.select(rank, nullptr));
+	for (int start = -100; start < 10400; start += 97) {
+		const int end = start + 333;
+		EXPECT_EQ(std::distance(keys.lower_bound(start), keys.upper_bound(end)), tree.countRange(start, end));
+	}
+	tree.freeze();
+	EXPECT_EQ(std::distance(keys.lower_bound(0), keys.upper_bound(5000)), tree.countRange(0, 5000));
+}
+
+TEST(BplustreeInsertTest, AggregateTest) {
+	Bplustree tree(5);
+	std::map<int, std::vector<int>> entries;
+	std::mt19937 gen(5);
+	for (int i = 0; i < 20000; i++) {
+		const int key = gen() % 5000;
+		const int value = static_cast<int>(gen() % 2001) - 1000;
+		tree.insert(key, value);
+		entries[key].push_back(value);
+	}
+	for (int start = -100; start < 5200; start += 131) {
+		const int end = start + 777;
+		Bplustree::Aggregate expected;
+		for (auto it = entries.lower_bound(start); it != entries.upper_bound(end); it++) {
+			for (int value : it->second) {
+				expected.sum += value;
+				expected.min = std::min(expected.min, value);
+				expected.max = std::max(expected.max, value);
+			}
+			expected.count += it->second.size();
+		}
+		const Bplustree::Aggregate result = tree.aggregate(start, end);
+		EXPECT_EQ(expected.count, result.count);
+		EXPECT_EQ(expected.sum, result.sum);
+		EXPECT_EQ(expected.min, result.min);
+		EXPECT_EQ(expected.max, result.max);
+	}
+	EXPECT_EQ(0, tree.aggregate(300, 200).count);
+	const long long count = tree.aggregate(0, 4999).count;
+	tree.freeze();
+	EXPECT_EQ(count, tree.aggregate(0, 4999).count);
+	EXPECT_EQ(tree.aggregate(17, 17).sum, std::accumulate(entries[17].begin(), entries[17].end(), 0LL));
+}
+
+TEST(BplustreeBulkLoadTest, BulkLoadSortedKeysTest) {
+	Bplustree tree(5);
+	std::vector<int> keys;
+	std::vector<int> values;
+	for (int i = 0; i < 1000; i++) {
+		keys.push_back(i);
+		values.push_back(i + 1);
+	}
+	tree.bulkLoad(keys, values);
+	EXPECT_EQ(1000, tree.getNumKeysStored());
+	for (int i = 0; i < 1000; i++) {
+		const ValueSlot *res = tree.search(i);
+		EXPECT_TRUE(res);
+		EXPECT_EQ((*res)[0], i + 1);
+	}
+	std::map<int, std::vector<int>> scanResult = tree.scan(100, 199);
+	EXPECT_EQ(100, scanResult.size());
+}
+
+TEST(BplustreeBulkLoadTest, BulkLoadUnsortedDuplicateKeysTest) {
+	Bplustree tree(4);
+	std::vector<int> keys;
+	std::vector<int> values;
+	for (int i = 0; i < 1000; i++) {
+		keys.push_back((i * 7919) % 500);
+		values.push_back(i);
+	}
+	tree.bulkLoad(keys, values, 0.5);
+	EXPECT_EQ(500, tree.getNumKeysStored());
+	const ValueSlot *res = tree.search(0);
+	EXPECT_TRUE(res);
+	EXPECT_EQ(res->size(), 2);
+	EXPECT_EQ((*res)[0], 0);
+	EXPECT_EQ((*res)[1], 500);
+	for (int i = 0; i < 500; i += 2) {
+		EXPECT_TRUE(tree.remove(i));
+	}
+	EXPECT_EQ(250, tree.getNumKeysStored());
+	tree.insert(1000, 1);
+	EXPECT_TRUE(tree.search(1000));
+	EXPECT_FALSE(tree.search(2));
+}
+
+TEST(BplustreeRemoveTest, RelaxedRemoveCompactTest) {
+	Bplustree tree(6);
+	tree.setRelaxedRemoves(true);
+	for (int i = 0; i < 2000; i++) {
+		tree.insert(i, i);
+		if (i % 100 == 0) {
+			tree.insert(i, std::vector<int>{i + 1, i + 2, i + 3, i + 4});
+		}
+	}
+	const long long numLeaves = tree.getStats().numLeaves;
+	for (int i = 0; i < 2000; i++) {
+		if (i % 5 != 0) {
+			EXPECT_TRUE(tree.remove(i));
+		}
+	}
+	TreeStats stats = tree.getStats();
+	EXPECT_EQ(400, stats.numKeys);
+	EXPECT_GT(stats.numDeferredRemoves, 0);
+	EXPECT_TRUE(tree.needsCompaction(0.5));
+	EXPECT_EQ(400, tree.scanFull().size());
+	EXPECT_FALSE(tree.search(1));
+	tree.compact();
+	stats = tree.getStats();
+	EXPECT_EQ(0, stats.numDeferredRemoves);
+	EXPECT_FALSE(tree.needsCompaction(0.5));
+	EXPECT_EQ(400, stats.numKeys);
+	EXPECT_EQ(480, stats.numValues);
+	EXPECT_EQ(80, stats.numLeaves);
+	EXPECT_LT(stats.numLeaves, numLeaves);
+	for (int i = 0; i < 2000; i += 5) {
+		const ValueSlot *res = tree.search(i);
+		ASSERT_TRUE(res);
+		EXPECT_EQ(i % 100 == 0 ? 5 : 1, res->size());
+		EXPECT_EQ(i, res->back() - (i % 100 == 0 ? 4 : 0));
+	}
+	tree.insert(1, 1);
+	EXPECT_TRUE(tree.remove(0));
+	EXPECT_EQ(400, tree.scanFull().size());
+}
+
+TEST(BplustreeRemoveTest, RemoveRangeTest) {
+	FixedBplustree<16> tree(16);
+	tree.setSubtreeCounts(true);
+	std::map<int, int> entries;
+	std::mt19937 gen(7);
+	for (int i = 0; i < 30000; i++) {
+		const int key = gen() % 20000;
+		tree.insert(key, key);
+		entries[key]++;
+	}
+	const long long numLeaves = tree.getStats().numLeaves;
+	for (int round = 0; round < 40; round++) {
+		const int start = static_cast<int>(gen() % 21000) - 500;
+		const int end = start + gen() % (round % 4 == 0 ? 5000 : 200);
+		long long numValues = 0;
+		for (auto it = entries.lower_bound(start); it != entries.upper_bound(end); it++) {
+			numValues += it->second;
+		}
+		const long long numKeys = std::distance(entries.lower_bound(start), entries.upper_bound(end));
+		const TreeStats stats = tree.getStats();
+		EXPECT_EQ(numKeys, tree.removeRange(start, end));
+		entries.erase(entries.lower_bound(start), entries.upper_bound(end));
+		EXPECT_EQ(stats.numKeys - numKeys, tree.getStats().numKeys);
+		EXPECT_EQ(stats.numValues - numValues, tree.getStats().numValues);
+	}
+	EXPECT_LT(tree.getStats().numLeaves, numLeaves);
+	EXPECT_EQ(0, tree.removeRange(300, 200));
+	FixedBplustree<16>::ScanResult result = tree.scanFull();
+	ASSERT_EQ(entries.size(), result.size());
+	int rank = 0;
+	for (const std::pair<const int, int> &entry : entries) {
+		EXPECT_EQ(rank++, tree.rank(entry.first));
+		ASSERT_TRUE(result.count(entry.first));
+		EXPECT_EQ(entry.second, result[entry.first].size());
+	}
+	EXPECT_EQ(entries.size(), tree.removeRange(-1, 20000));
+	EXPECT_EQ(0, tree.getStats().numKeys);
+	EXPECT_EQ(1, tree.getStats().numLeaves);
+	tree.insert(5, 5);
+	EXPECT_TRUE(tree.search(5));
+	// At a small order ranges cross several levels of internal nodes. The largest key goes first, so that no insert appends to the rightmost leaf and splits it unevenly.
+	Bplustree small(5);
+	std::vector<int> keys(5000);
+	std::iota(keys.begin(), keys.end(), 0);
+	std::shuffle(keys.begin(), keys.end() - 1, gen);
+	std::set<int> remaining(keys.begin(), keys.end());
+	small.insert(keys.back(), keys.back());
+	for (int i = 0; i < keys.size() - 1; i++) {
+		small.insert(keys[i], keys[i]);
+	}
+	ASSERT_TRUE(small.isBalanced());
+	EXPECT_GE(small.getStats().height, 5);
+	for (int round = 0; round < 60; round++) {
+		const int start = gen() % 5000;
+		const int end = start + gen() % (round % 3 == 0 ? 400 : 40);
+		const long long numKeys = std::distance(remaining.lower_bound(start), remaining.upper_bound(end));
+		EXPECT_EQ(numKeys, small.removeRange(start, end));
+		remaining.erase(remaining.lower_bound(start), remaining.upper_bound(end));
+		ASSERT_TRUE(small.isBalanced()) << "after removing [" << start << ", " << end << "]";
+		EXPECT_EQ(remaining.size(), small.getNumKeysStored());
+	}
+	EXPECT_EQ(remaining.size(), small.scanFull().size());
+}
+
+TEST(BplustreeSplitTest, SplitAtConcatTest) {
+	FixedBplustree<16> *tree = new FixedBplustree<16>(16);
+	tree->setSubtreeCounts(true);
+	for (int i = 0; i < 20000; i++) {
+		tree->insert(i, i);
+		if (i % 100 == 0) {
+			tree->insert(i, std::vector<int>{i + 1, i + 2, i + 3, i + 4});
+		}
+	}
+	FixedBplustree<16> *right = tree->splitAt(12345);
+	EXPECT_EQ(12345, tree->getNumKeysStored());
+	EXPECT_EQ(20000 - 12345, right->getNumKeysStored());
+	EXPECT_EQ(12345 + 124 * 4, tree->getStats().numValues);
+	EXPECT_FALSE(tree->search(12345));
+	EXPECT_EQ(12400, right->search(12400)->front());
+	EXPECT_EQ(5, right->search(12400)->size());
+	EXPECT_EQ(100, right->rank(12445));
+	EXPECT_EQ(12345, tree->scanFull().size());
+	EXPECT_THROW(right->concat(*tree), std::string);
+	right->insert(30000, 1);
+	right->remove(15000);
+	tree->remove(0);
+	delete tree;
+	FixedBplustree<16> low(16);
+	low.setSubtreeCounts(true);
+	for (int i = -50; i < 0; i++) {
+		low.insert(i, i);
+	}
+	low.concat(*right);
+	delete right;
+	EXPECT_EQ(50 + 20000 - 12345, low.getNumKeysStored());
+	EXPECT_EQ(50 + 7655 + 75 * 4, low.getStats().numValues);
+	EXPECT_EQ(60, low.rank(12355));
+	EXPECT_EQ(7655, low.countRange(0, 30000));
+	EXPECT_EQ(1, low.search(30000)->front());
+	Bplustree small(5);
+	Bplustree large(5);
+	for (int i = 0; i < 3; i++) {
+		small.insert(i, i);
+	}
+	for (int i = 3; i < 5000; i++) {
+		large.insert(i, i);
+	}
+	small.concat(large);
+	EXPECT_EQ(0, large.getNumKeysStored());
+	EXPECT_EQ(5000, small.getNumKeysStored());
+	EXPECT_EQ(5000, small.scanFull().size());
+	Bplustree *empty = small.splitAt(-1);
+	EXPECT_EQ(0, small.getNumKeysStored());
+	EXPECT_EQ(5000, empty->getNumKeysStored());
+	delete empty;
+	small.insert(7, 7);
+	EXPECT_TRUE(small.search(7));
+	// Both cut edges are repaired, in a tree whose largest key goes first so that no insert splits unevenly
+	std::mt19937 gen(11);
+	std::vector<int> keys(400);
+	std::iota(keys.begin(), keys.end(), 0);
+	std::shuffle(keys.begin(), keys.end() - 1, gen);
+	for (int cut = 0; cut <= 400; cut++) {
+		Bplustree *left = new Bplustree(5);
+		left->insert(keys.back(), keys.back());
+		for (int i = 0; i < keys.size() - 1; i++) {
+			left->insert(keys[i], keys[i]);
+		}
+		ASSERT_TRUE(left->isBalanced());
+		Bplustree *cutRight = left->splitAt(cut);
+		EXPECT_EQ(cut, left->getNumKeysStored());
+		EXPECT_EQ(400 - cut, cutRight->getNumKeysStored());
+		EXPECT_TRUE(left->isBalanced()) << "left of " << cut;
+		EXPECT_TRUE(cutRight->isBalanced()) << "right of " << cut;
+		left->concat(*cutRight);
+		EXPECT_TRUE(left->isBalanced()) << "rejoined at " << cut;
+		EXPECT_EQ(400, left->scanFull().size());
+		delete cutRight;
+		delete left;
+	}
+}
+
+TEST_F(BplustreeTest, FreezeThawTest) {
+	tree.insert(7, std::vector<int>{1, 2, 3, 4, 5});
+	tree.freeze();
+	EXPECT_TRUE(tree.isFrozen());
+	EXPECT_THROW(tree.insert(2000, 1), std::string);
+	for (int i = -5; i < 1005; i++) {
+		const ValueSlot *res = tree.search(i);
+		EXPECT_EQ(i >= 0 && i < 1000, res != nullptr);
+		if (res) {
+			EXPECT_EQ(i + 1, (*res)[0]);
+		}
+	}
+	EXPECT_EQ(6, tree.search(7)->size());
+	EXPECT_EQ(100, tree.scan(100, 199).size());
+	Bplustree::Cursor cursor = tree.getCursor();
+	cursor.seek(998);
+	EXPECT_EQ(998, cursor.getKey());
+	EXPECT_TRUE(cursor.next());
+	EXPECT_FALSE(cursor.next());
+	tree.thaw();
+	EXPECT_FALSE(tree.isFrozen());
+	tree.insert(2000, 1);
+	EXPECT_TRUE(tree.remove(7));
+	EXPECT_EQ(1000, tree.scanFull().size());
+}
+
+TEST_F(BplustreeTest, CursorTest) {
+	Bplustree::Cursor cursor = tree.getCursor();
+	int expectedKey = 0;
+	for (; cursor.isValid(); cursor.next()) {
+		EXPECT_EQ(expectedKey, cursor.getKey());
+		EXPECT_EQ(expectedKey + 1, cursor.getValues()[0]);
+		expectedKey++;
+	}
+	EXPECT_EQ(1000, expectedKey);
+	cursor.seekToLast();
+	for (; cursor.isValid(); cursor.prev()) {
+		expectedKey--;
+		EXPECT_EQ(expectedKey, cursor.getKey());
+	}
+	EXPECT_EQ(0, expectedKey);
+	tree.remove(500);
+	cursor.seek(500);
+	EXPECT_TRUE(cursor.isValid());
+	EXPECT_EQ(501, cursor.getKey());
+	cursor.seek(1000);
+	EXPECT_FALSE(cursor.isValid());
+}
+
+TEST_F(BplustreeTest, CursorFetchTest) {
+	Bplustree::Cursor cursor = tree.getCursor();
+	cursor.seek(100);
+	int keys[64];
+	const ValueSlot *values[64];
+	int numFetched = 0;
+	int count;
+	while ((count = cursor.fetch(keys, values, 64, 299)) > 0) {
+		for (int i = 0; i < count; i++) {
+			EXPECT_EQ(100 + numFetched + i, keys[i]);
+			EXPECT_EQ(keys[i] + 1, (*values[i])[0]);
+		}
+		numFetched += count;
+	}
+	EXPECT_EQ(200, numFetched);
+	EXPECT_TRUE(cursor.isValid());
+	EXPECT_EQ(300, cursor.getKey());
+}
+
+TEST(FixedBplustreeTest, InsertSearchRemoveTest) {
+	FixedBplustree<16> tree;
+	for (int i = 0; i < 1000; i++) {
+		tree.insert(i, i + 1);
+	}
+	EXPECT_EQ(1000, tree.getNumKeysStored());
+	for (int i = 0; i < 1000; i++) {
+		const ValueSlot *res = tree.search(i);
+		EXPECT_TRUE(res);
+		EXPECT_EQ((*res)[0], i + 1);
+	}
+	for (int i = 0; i < 1000; i += 2) {
+		EXPECT_TRUE(tree.remove(i));
+	}
+	EXPECT_EQ(500, tree.getNumKeysStored());
+	EXPECT_FALSE(tree.search(500));
+	EXPECT_TRUE(tree.search(501));
+}
+
+TEST(FixedBplustreeTest, NodeArenaReuseTest) {
+	FixedBplustree<16> tree(16, true);
+	for (int i = 0; i < 1000; i++) {
+		tree.insert(i, i);
+	}
+	const std::size_t bytesInUse = tree.getNodeBytesInUse();
+	EXPECT_GT(bytesInUse, 0);
+	EXPECT_LE(bytesInUse, tree.getNodeBytesReserved());
+	for (int i = 0; i < 1000; i++) {
+		EXPECT_TRUE(tree.remove(i));
+	}
+	EXPECT_LT(tree.getNodeBytesInUse(), bytesInUse);
+	const std::size_t bytesReserved = tree.getNodeBytesReserved();
+	for (int i = 0; i < 1000; i++) {
+		tree.insert(i, i);
+	}
+	EXPECT_EQ(bytesReserved, tree.getNodeBytesReserved());
+	EXPECT_EQ(1000, tree.getNumKeysStored());
+}
+
+TEST(FixedBplustreeTest, SpilledValuesReuseTest) {
+	FixedBplustree<16> tree;
+	for (int i = 0; i < 100; i++) {
+		tree.insert(i, std::vector<int>(i % 10, i));
+	}
+	const ValueSlot *res = tree.search(9);
+	EXPECT_TRUE(res);
+	EXPECT_EQ(res->size(), 9);
+	EXPECT_EQ((*res)[8], 9);
+	const std::size_t bytesInUse = tree.getValueBytesInUse();
+	EXPECT_GT(bytesInUse, 0);
+	for (int i = 0; i < 100; i++) {
+		EXPECT_TRUE(tree.update(i, {i}));
+	}
+	EXPECT_EQ(0, tree.getValueBytesInUse());
+	for (int i = 0; i < 100; i++) {
+		EXPECT_TRUE(tree.update(i, std::vector<int>(i % 10, i)));
+	}
+	EXPECT_EQ(bytesInUse, tree.getValueBytesInUse());
+	for (int i = 0; i < 100; i++) {
+		EXPECT_TRUE(tree.remove(i));
+	}
+	EXPECT_EQ(0, tree.getValueBytesInUse());
+}
+
+TEST(NodeSearchTest, RankSearchMatchesLowerBoundTest) {
+	for (int numKeys = 0; numKeys <= 300; numKeys++) {
+		std::vector<int> keys;
+		for (int i = 0; i < numKeys; i++) {
+			keys.push_back((i * 37) % 101 - 50);
+		}
+		std::sort(keys.begin(), keys.end());
+		for (int key = -52; key <= 52; key++) {
+			int expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+			EXPECT_EQ(expected, rankSearch(keys.data(), numKeys, key));
+		}
+	}
+}
+
+TEST(NodeSearchTest, RankSearch64MatchesLowerBoundTest) {
+	for (int numKeys = 0; numKeys <= 300; numKeys++) {
+		std::vector<std::int64_t> keys;
+		for (int i = 0; i < numKeys; i++) {
+			keys.push_back(((i * 37) % 101 - 50) * 10000000000LL);
+		}
+		std::sort(keys.begin(), keys.end());
+		for (int key = -52; key <= 52; key++) {
+			int expected = std::lower_bound(keys.begin(), keys.end(), key * 10000000000LL) - keys.begin();
+			EXPECT_EQ(expected, rankSearch64(keys.data(), numKeys, key * 10000000000LL));
+		}
+	}
+}
+
+TEST(KeyTypeTest, Int64KeysTest) {
+	KeyBplustree<std::int64_t> tree(5);
+	const std::int64_t base = 1LL << 40;
+	for (int i = 0; i < 1000; i++) {
+		tree.insert(base + (i * 7919) % 1000 - 500, i);
+	}
+	EXPECT_EQ(1000, tree.getNumKeysStored());
+	// Keys that only differ above 32 bits must not collide
+	EXPECT_FALSE(tree.search((base + 1) & 0xFFFFFFFF));
+	EXPECT_TRUE(tree.search(base - 500));
+	std::int64_t expected = base - 500;
+	for (KeyBplustree<std::int64_t>::Cursor cursor = tree.getCursor(); cursor.isValid(); cursor.next()) {
+		EXPECT_EQ(expected++, cursor.getKey());
+	}
+	EXPECT_EQ(base + 500, expected);
+	for (int i = 0; i < 1000; i += 2) {
+		EXPECT_TRUE(tree.remove(base + i - 500));
+	}
+	EXPECT_EQ(500, tree.getNumKeysStored());
+	EXPECT_EQ(250, tree.scan(base - 500, base - 1).size());
+}
+
+TEST(KeyTypeTest, FixedKeysTest) {
+	typedef FixedKey<16> Key;
+	KeyBplustree<Key> tree(5);
+	std::vector<Key> keys;
+	std::vector<int> values;
+	for (int i = -500; i < 500; i++) {
+		keys.push_back(Key::fromInteger(i));
+		values.push_back(i);
+	}
+	std::reverse(keys.begin(), keys.end());
+	std::reverse(values.begin(), values.end());
+	tree.bulkLoad(keys, values);
+	tree.insert(Key::fromInteger(1000), 1000);
+	EXPECT_EQ(1001, tree.getNumKeysStored());
+	const KeyBplustree<Key>::ValueSlot *res = tree.search(Key::fromInteger(-3));
+	EXPECT_TRUE(res);
+	EXPECT_EQ(-3, (*res)[0]);
+	EXPECT_FALSE(tree.search(Key::fromInteger(600)));
+	// Normalized keys keep integer order under memcmp, negative keys first
+	KeyBplustree<Key>::ScanResult result = tree.scan(Key::fromInteger(-10), Key::fromInteger(10));
+	EXPECT_EQ(21, result.size());
+	EXPECT_EQ(-10, result.begin()->second[0]);
+	EXPECT_EQ(10, result.rbegin()->second[0]);
+	EXPECT_TRUE(tree.remove(Key::fromInteger(0)));
+	EXPECT_FALSE(tree.search(Key::fromInteger(0)));
+}
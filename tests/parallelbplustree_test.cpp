@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "parallelbplustree.hpp"
+#include <numeric>
 
 class ParallelBplustreeBloomEnabledTest : public ::testing::Test {
 	protected:
@@ -24,11 +25,11 @@ class ParallelBplustreeBloomDisabledTest : public ::testing::Test {
 };
 
 TEST_F(ParallelBplustreeBloomEnabledTest, SearchForKeysInTreeTest) {
-	std::future<std::vector<std::future<const std::vector<int> *>>> futRes;
-	std::vector<std::future<const std::vector<int> *>> wrapperRes;
-	const std::vector<int> *resPart;
+	std::future<std::vector<std::future<const ValueSlot *>>> futRes;
+	std::vector<std::future<const ValueSlot *>> wrapperRes;
+	const ValueSlot *resPart;
 	for (int i = 0; i < 30; i += 10) {
-		std::vector<const std::vector<int> *> validKeysInTrees;
+		std::vector<const ValueSlot *> validKeysInTrees;
 		futRes = tree.search(i);
 		wrapperRes = futRes.get();
 		for (int j = 0; j < wrapperRes.size(); j++) {
@@ -43,18 +44,18 @@ TEST_F(ParallelBplustreeBloomEnabledTest, SearchForKeysInTreeTest) {
 }
 
 TEST_F(ParallelBplustreeBloomEnabledTest, SearchForKeyNotInTreeTest) {
-	std::vector<std::future<const std::vector<int> *>> wrapperRes = tree.search(1001).get();
+	std::vector<std::future<const ValueSlot *>> wrapperRes = tree.search(1001).get();
 	for (int i = 0; i < wrapperRes.size(); i++) {
-		const std::vector<int> *resPart = wrapperRes[i].get();
+		const ValueSlot *resPart = wrapperRes[i].get();
 		EXPECT_FALSE(resPart);
 	}
 }
 
 TEST_F(ParallelBplustreeBloomEnabledTest, SearchBatchTest) {
 	std::vector<int> keys = {10, 23, 192, 1, 19, 391, 10000};
-	std::vector<std::vector<const std::vector<int> *>> result = tree.search(keys);
+	std::vector<std::vector<const ValueSlot *>> result = tree.search(keys);
 	tree.waitForWorkToFinish();
-	std::vector<std::vector<const std::vector<int> *>> processedResult(result.size());
+	std::vector<std::vector<const ValueSlot *>> processedResult(result.size());
 	for (int i = 0; i < result.size(); i++) {
 		for (int j = 0; j < result[i].size(); j++) {
 			if (result[i][j]) {
@@ -68,3 +69,264 @@ TEST_F(ParallelBplustreeBloomEnabledTest, SearchBatchTest) {
 	}
 	EXPECT_EQ(processedResult[keys.size() - 1].size(), 0);
 }
+
+TEST_F(ParallelBplustreeBloomEnabledTest, FrozenSearchTest) {
+	tree.freeze();
+	EXPECT_TRUE(tree.isFrozen());
+	EXPECT_THROW(tree.insert(2000, 1), std::string);
+	std::vector<int> keys = {10, 23, 192, 1, 19, 391, 10000};
+	std::vector<std::vector<const ValueSlot *>> result = tree.search(keys);
+	tree.waitForWorkToFinish();
+	for (int i = 0; i < keys.size(); i++) {
+		int hits = 0;
+		for (int j = 0; j < result[i].size(); j++) {
+			if (result[i][j]) {
+				EXPECT_EQ(keys[i] + 1, (*(result[i][j]))[0]);
+				hits++;
+			}
+		}
+		EXPECT_EQ(keys[i] < 1000 ? 1 : 0, hits);
+	}
+	tree.thaw();
+	tree.insert(2000, 1);
+	tree.waitForWorkToFinish();
+	int numKeys = 0;
+	for (int num : tree.getTreeNumKeys()) {
+		numKeys += num;
+	}
+	EXPECT_EQ(1001, numKeys);
+}
+
+TEST_F(ParallelBplustreeBloomEnabledTest, CountRangeTest) {
+	EXPECT_THROW(tree.countRange(0, 10), std::string);
+	tree.setSubtreeCounts(true);
+	EXPECT_EQ(1000, tree.countRange(0, 999));
+	EXPECT_EQ(101, tree.countRange(100, 200));
+	EXPECT_EQ(0, tree.countRange(200, 100));
+	EXPECT_EQ(500, tree.rank(500));
+	std::vector<int> keys = {100, 150, 5000};
+	tree.remove(keys);
+	tree.waitForWorkToFinish();
+	EXPECT_EQ(99, tree.countRange(100, 200));
+	tree.freeze();
+	EXPECT_EQ(99, tree.countRange(100, 200));
+	EXPECT_EQ(998, tree.rank(2000));
+}
+
+TEST_F(ParallelBplustreeBloomEnabledTest, AggregateTest) {
+	ParallelBplustree::Aggregate result = tree.aggregate(100, 199);
+	EXPECT_EQ(100, result.count);
+	EXPECT_EQ((101 + 200) * 100 / 2, result.sum);
+	EXPECT_EQ(101, result.min);
+	EXPECT_EQ(200, result.max);
+	tree.freeze();
+	EXPECT_EQ(1000, tree.aggregate(-5, 5000).count);
+}
+
+TEST_F(ParallelBplustreeBloomDisabledTest, RemoveRangeTest) {
+	EXPECT_EQ(101, tree.removeRange(100, 200));
+	EXPECT_EQ(0, tree.removeRange(150, 160));
+	tree.waitForWorkToFinish();
+	std::vector<int> treeNumKeys = tree.getTreeNumKeys();
+	EXPECT_EQ(899, std::accumulate(treeNumKeys.begin(), treeNumKeys.end(), 0));
+	EXPECT_EQ(0, tree.aggregate(100, 200).count);
+	EXPECT_EQ(99, tree.aggregate(201, 299).count);
+	tree.freeze();
+	EXPECT_THROW(tree.removeRange(0, 10), std::string);
+}
+
+TEST(ParallelBplustreeBatchInsertTest, RepeatedNewKeyTest) {
+	ParallelBplustree tree(5, 4, 8, true);
+	std::vector<int> keys(400, 42);
+	std::vector<int> values(400);
+	std::iota(values.begin(), values.end(), 0);
+	tree.insert(keys, values);
+	tree.waitForWorkToFinish();
+	std::vector<int> treeNumKeys = tree.getTreeNumKeys();
+	EXPECT_EQ(1, std::accumulate(treeNumKeys.begin(), treeNumKeys.end(), 0));
+}
+
+TEST(PartitionedParallelBplustreeTest, PointOperationsTest) {
+	std::vector<int> sample(1000);
+	std::iota(sample.begin(), sample.end(), 0);
+	std::vector<const Partitioner<BplustreeTraits<>> *> partitioners = {new HashPartitioner<BplustreeTraits<>>(4), new RangePartitioner<BplustreeTraits<>>(4, sample)};
+	for (const Partitioner<BplustreeTraits<>> *partitioner : partitioners) {
+		ParallelBplustree tree(5, 4, 4, true);
+		tree.setPartitioner(partitioner);
+		std::vector<int> keys(sample.begin(), sample.end() - 100);
+		std::vector<int> values(keys.size(), 1);
+		tree.insert(keys, values);
+		for (int i = 900; i < 1000; i++) {
+			tree.insert(i, 1);
+		}
+		tree.waitForWorkToFinish();
+		std::vector<int> treeNumKeys = tree.getTreeNumKeys();
+		EXPECT_EQ(1000, std::accumulate(treeNumKeys.begin(), treeNumKeys.end(), 0));
+		for (int i = 0; i < treeNumKeys.size(); i++) {
+			EXPECT_GT(treeNumKeys[i], 100);
+		}
+		std::vector<std::future<const ValueSlot *>> found = tree.search(950).get();
+		ASSERT_EQ(1, found.size());
+		EXPECT_EQ(1, (*found[0].get())[0]);
+		std::vector<int> newValues = {7};
+		tree.update(950, newValues);
+		tree.remove(951).get()[0].get();
+		std::vector<int> removeKeys = {10, 20, 30};
+		tree.remove(removeKeys);
+		tree.waitForWorkToFinish();
+		std::vector<int> searchKeys = {950, 951, 10, 11};
+		std::vector<std::vector<const ValueSlot *>> result = tree.search(searchKeys);
+		tree.waitForWorkToFinish();
+		std::vector<int> hits(result.size(), 0);
+		for (int i = 0; i < result.size(); i++) {
+			for (const ValueSlot *slot : result[i]) {
+				hits[i] += slot != nullptr;
+			}
+		}
+		EXPECT_EQ(std::vector<int>({1, 0, 0, 1}), hits);
+		EXPECT_EQ(7, (*result[0][partitioner->getPartition(950)])[0]);
+		EXPECT_THROW(tree.setPartitioner(new HashPartitioner<BplustreeTraits<>>(4)), std::string);
+	}
+	EXPECT_THROW(ParallelBplustree(5, 4, 3, false).setPartitioner(new HashPartitioner<BplustreeTraits<>>(4)), std::string);
+}
+
+TEST(PartitionedParallelBplustreeTest, SharedNothingTest) {
+	ParallelBplustree tree(5, 2, 4, false);
+	EXPECT_THROW(tree.setSharedNothing(true), std::string);
+	tree.setPartitioner(new HashPartitioner<BplustreeTraits<>>(4));
+	tree.setSharedNothing(true);
+	EXPECT_TRUE(tree.isSharedNothing());
+	tree.setRelaxedRemoves(true);
+	tree.setSubtreeCounts(true);
+	std::vector<int> keys(1000);
+	std::iota(keys.begin(), keys.end(), 0);
+	std::vector<int> values(keys.size(), 1);
+	tree.insert(keys, values);
+	for (int i = 1000; i < 2000; i++) {
+		tree.insert(i, 1);
+	}
+	std::vector<int> removeKeys(keys.begin(), keys.begin() + 500);
+	tree.remove(removeKeys);
+	EXPECT_TRUE(tree.remove(1999).get()[0].get());
+	tree.waitForWorkToFinish();
+	EXPECT_EQ(1499, tree.countRange(0, 5000));
+	EXPECT_EQ(100, tree.removeRange(1000, 1099));
+	const ValueSlot *found = tree.search(1500).get()[0].get();
+	ASSERT_NE(nullptr, found);
+	EXPECT_EQ(1, (*found)[0]);
+	tree.freeze();
+	EXPECT_EQ(1399, tree.aggregate(0, 5000).sum);
+	tree.thaw();
+	tree.setSharedNothing(false);
+	tree.insert(5000, 1);
+	tree.waitForWorkToFinish();
+	EXPECT_EQ(1400, tree.countRange(0, 5000));
+}
+
+TEST(FixedParallelBplustreeTest, SearchBatchTest) {
+	FixedParallelBplustree<16> tree(16, std::thread::hardware_concurrency(), std::thread::hardware_concurrency(), true);
+	for (int i = 0; i < 1000; i++) {
+		tree.insert(i, i + 1);
+	}
+	tree.waitForWorkToFinish();
+	std::vector<int> keys = {10, 23, 192, 1, 19, 391};
+	std::vector<std::vector<const ValueSlot *>> result = tree.search(keys);
+	tree.waitForWorkToFinish();
+	for (int i = 0; i < keys.size(); i++) {
+		int hits = 0;
+		for (int j = 0; j < result[i].size(); j++) {
+			if (result[i][j]) {
+				EXPECT_EQ(keys[i] + 1, (*(result[i][j]))[0]);
+				hits++;
+			}
+		}
+		EXPECT_EQ(hits, 1);
+	}
+}
+
+TEST(BplustreeParallelScanTest, ParallelScanMatchesCursorTest) {
+	Bplustree tree(5);
+	for (int i = 0; i < 10000; i++) {
+		tree.insert(i * 2, i);
+	}
+	thread_pool pool(4);
+	std::vector<int> keys;
+	for (const Bplustree::ScanChunk &chunk : tree.parallelScanFull(pool)) {
+		keys.insert(keys.end(), chunk.keys.begin(), chunk.keys.end());
+	}
+	EXPECT_EQ(10000, keys.size());
+	for (int i = 0; i < keys.size(); i++) {
+		EXPECT_EQ(i * 2, keys[i]);
+	}
+	std::atomic<long long> valueSum = 0;
+	tree.parallelScan(pool, 1001, 2000, [&valueSum](const std::size_t partition, const int *keys, const ValueSlot *const *values, const int count) {
+		for (int i = 0; i < count; i++) {
+			valueSum += (*values[i])[0];
+		}
+	});
+	// Keys 1002, 1004, ..., 2000 hold the values 501, ..., 1000
+	EXPECT_EQ((501 + 1000) * 500 / 2, valueSum);
+	Bplustree::Aggregate aggregate = tree.parallelAggregate(pool, 1001, 2000);
+	EXPECT_EQ(500, aggregate.count);
+	EXPECT_EQ(valueSum, aggregate.sum);
+	EXPECT_EQ(501, aggregate.min);
+	EXPECT_EQ(1000, aggregate.max);
+	EXPECT_EQ(tree.aggregate(-1, 30000).sum, tree.parallelAggregate(pool, -1, 30000).sum);
+}
+
+TEST(ThreadPoolTest, NestedTasksTest) {
+	thread_pool pool(4);
+	std::atomic<long long> sum = 0;
+	for (int i = 0; i < 10000; i++) {
+		pool.push_task([&pool, &sum, i] {
+			sum += i;
+			if (i % 10 == 0) {
+				pool.push_task([&sum] { sum += 1; });
+			}
+		});
+	}
+	std::future<int> answer = pool.submit([] { return 42; });
+	pool.wait_for_tasks();
+	EXPECT_EQ(10000LL * 9999 / 2 + 1000, sum);
+	EXPECT_EQ(42, answer.get());
+	EXPECT_EQ(0, pool.get_tasks_total());
+	pool.paused = true;
+	for (int i = 0; i < 100; i++) {
+		pool.push_task([&sum] { sum += 1; });
+	}
+	pool.reset(2);
+	EXPECT_EQ(100, pool.get_tasks_queued());
+	pool.paused = false;
+	pool.wait_for_tasks();
+	EXPECT_EQ(10000LL * 9999 / 2 + 1100, sum);
+}
+
+TEST(ThreadPoolTest, BulkAndLargeTasksTest) {
+	thread_pool pool(4);
+	std::atomic<long long> sum = 0;
+	std::vector<std::function<void()>> tasks;
+	for (int i = 0; i < 1000; i++) {
+		tasks.push_back([&sum, i] { sum += i; });
+	}
+	pool.push_tasks(tasks.begin(), tasks.end());
+	auto addOwned = [&sum](std::unique_ptr<int> value) {
+		return [&sum, value = std::move(value)] { sum += *value; };
+	};
+	std::vector<decltype(addOwned(nullptr))> moveOnlyTasks;
+	for (int i = 0; i < 100; i++) {
+		moveOnlyTasks.push_back(addOwned(std::make_unique<int>(1)));
+	}
+	pool.push_tasks(std::make_move_iterator(moveOnlyTasks.begin()), std::make_move_iterator(moveOnlyTasks.end()));
+	pool.push_tasks(tasks.end(), tasks.end());
+	pool.push_task(addOwned(std::make_unique<int>(1)));
+	std::array<long long, 32> large;
+	large.fill(1);
+	pool.push_task([&sum, large] {
+		for (long long value : large) {
+			sum += value;
+		}
+	});
+	pool.wait_for_tasks();
+	EXPECT_EQ(1000LL * 999 / 2 + 101 + 32, sum);
+	EXPECT_EQ(32, pool.submit([large] { return (int)large.size(); }).get());
+}